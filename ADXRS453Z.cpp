@@ -25,6 +25,7 @@ ADXRS453Z::ADXRS453Z() {
 	iLoop = 0;
 
 	accumulated_angle = 0.0;
+	total_angle = 0.0;
 	current_rate = 0.0;
 	accumulated_offset = 0.0;
 	rate_offset = 0.0;
@@ -79,6 +80,7 @@ void ADXRS453Z::UpdateData() {
 
 	accumulated_offset += rate * (thisTime - lastTime);
 	accumulated_angle += current_rate * (thisTime - lastTime);
+	total_angle += current_rate * (thisTime - lastTime);
 	lastTime = thisTime;
 	iLoop++;
 }
@@ -101,6 +103,10 @@ float ADXRS453Z::GetRate() {
 float ADXRS453Z::GetAngle() {
 	return accumulated_angle;
 }
+float ADXRS453Z::GetHeading() {
+	// degrees clockwise since power up, the moves zero the angle but odometry can't have it jump
+	return total_angle;
+}
 void ADXRS453Z::SetAngle(float angle){
 	accumulated_angle = angle;
 }
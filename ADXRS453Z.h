@@ -21,6 +21,7 @@ class ADXRS453Z : public PIDSource{
 		static void StartTask(ADXRS453Z *pThis);
 		float GetRate();
 		float GetAngle();
+		float GetHeading();
 		void SetAngle(float angle);
 		void Reset();
 		void Zero(); //added by Taylor Smith
@@ -39,6 +40,7 @@ class ADXRS453Z : public PIDSource{
 		static const unsigned char THIRD_BYTE_DATA = 0xFC; //mask to find sensor data bits on third byte: D D D D D D X X
 		static const unsigned char READ_COMMAND = 0x20; //0010 0000 for first byte
 		float accumulated_angle;
+		float total_angle; //like accumulated_angle but Zero() leaves it alone
 		Timer * update_timer;
 		Timer * calibration_timer;
 		float current_rate;
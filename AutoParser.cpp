@@ -4,6 +4,7 @@
 
 #include <Autonomous.h>
 #include <AutoParser.h>
+#include <AutoProgram.h>
 #include <ComponentBase.h>
 #include <RobotParams.h>
 #include <string.h>
@@ -21,129 +22,57 @@ using namespace std;
 
 
 
-const char *szTokens[] = {
-		"MODE",
-		"DEBUG",
-		"MESSAGE",
-		"BEGIN",
-		"END",
-		"DELAY",			//!<(seconds)
-		"MOVE",				//!<(left speed) (right speed)
-		"MMOVE",	        //!<(speed) (distance:inches) (timeout)
-		"PMOVE",	        //!<(speed) (distance:inches) (timeout)
-		"TURN",				//!<(degrees) (timeout)
-		"RGEAR",
-		"HGEAR",
-		"GEARM",
-		"CLIMBER",
-		"NOP" };
-
-bool Autonomous::Evaluate(std::string rStatement) {
-	char *pToken;
-	char *pCurrLinePos;
-	int iCommand;
-	float fParam1;
+bool Autonomous::Evaluate(const AutoInstruction &rInstruction) {
 	bool bReturn = false; ///setting this to true WILL cause auto parsing to quit!
 	string rStatus;
 
-	if(rStatement.empty()) {
-		printf("statement is empty");
-		return (bReturn);
-	}
-
-	// process the autonomous motion
-
-	pCurrLinePos = (char *) rStatement.c_str();
-
-	if(*pCurrLinePos == sComment) {
-		return (bReturn);
-	}
-
-	// find first token
-
-	pToken = strtok_r(pCurrLinePos, szDelimiters, &pCurrLinePos);
-
-	if(pToken == NULL)
-	{
-		SmartDashboard::PutString("Auto Status","DEATH BY PARAMS!");
-		PRINTAUTOERROR;
-		rStatus.append("missing token");
-		printf("%0.3lf %s\n", pDebugTimer->Get(), rStatement.c_str());
-		return (true);
-	}
-
-	// which command are we to execute??
-	// this can be (easily) be made much faster... any student want to improve on this?
-
-	for(iCommand = AUTO_TOKEN_MODE; iCommand < AUTO_TOKEN_LAST; iCommand++) {
-		//printf("comparing %s to %s\n", pToken, szTokens[iCommand]);
-		if(!strncmp(pToken, szTokens[iCommand], strlen(szTokens[iCommand]))) {
-			break;
-		}
-	}
-
-	if(iCommand == AUTO_TOKEN_LAST) {
-		// no valid token found
-		rStatus.append("no tokens - check script spelling");
-		//printf("%0.3lf %s\n", pDebugTimer->Get(), rStatement.c_str());
-		return (true);
-	}
+	// the script was tokenized and checked when it was loaded, all we
+	// have to do here is run the instruction
 
 	// if we are paused wait here before executing a real command
 
-	while(bPauseAutoMode)
-	{
-		Wait(0.02);
-	}
+	WaitWhilePaused();
 
 	// execute the proper command
 
 	if(iAutoDebugMode)
 	{
-		printf("%0.3lf %s %s\n", pDebugTimer->Get(), pToken, pCurrLinePos);
+		printf("%0.3lf %s\n", pDebugTimer->Get(), rInstruction.sText.c_str());
 	}
 
-	switch (iCommand)
+	// the timeout of the command, if it has one, limits how long we wait for it
+
+	fBranchTimeout = rInstruction.fTimeout;
+
+	switch (rInstruction.iCommand)
 	{
 
 	case AUTO_TOKEN_BEGIN:
-		Begin(pCurrLinePos);
+		Begin(rInstruction);
 		rStatus.append("begin");
 		break;
 
 	case AUTO_TOKEN_END:
-		End(pCurrLinePos);
+		End(rInstruction);
 		rStatus.append("done");
 		bReturn = true;
 		break;
 
 	case AUTO_TOKEN_DEBUG:
-		pToken = strtok_r(pCurrLinePos, szDelimiters, &pCurrLinePos);
-		iAutoDebugMode = atoi(pToken);
+		iAutoDebugMode = (int)rInstruction.fParam[0];
 		break;
 
 	case AUTO_TOKEN_MESSAGE:
-		printf("%0.3lf %03d: %s\n", pDebugTimer->Get(), lineNumber, pCurrLinePos);
+		printf("%0.3lf %03d: %s\n", pDebugTimer->Get(), rInstruction.iLine, rInstruction.sArgs.c_str());
 		break;
 
 	case AUTO_TOKEN_DELAY:
-		pToken = strtok_r(pCurrLinePos, szDelimiters, &pCurrLinePos);
-
-		if (pToken == NULL)
-		{
-			rStatus.append("missing parameter");
-		}
-		else
-		{
-			fParam1 = atof(pToken);
-			rStatus.append("wait");
-
-			Delay(fParam1);
-		}
+		rStatus.append("wait");
+		Delay(rInstruction.fParam[0]);
 		break;
 
 	case AUTO_TOKEN_MOVE:
-		if (!Move(pCurrLinePos))
+		if (!Move(rInstruction))
 		{
 			rStatus.append("move error");
 		}
@@ -154,7 +83,7 @@ bool Autonomous::Evaluate(std::string rStatement) {
 		break;
 
 	case AUTO_TOKEN_MMOVE:
-		if (!MeasuredMove(pCurrLinePos))
+		if (!MeasuredMove(rInstruction))
 		{
 			rStatus.append("move error");
 		}
@@ -165,7 +94,7 @@ bool Autonomous::Evaluate(std::string rStatement) {
 		break;
 
 	case AUTO_TOKEN_MPROXIMITY:
-		if (!MeasuredMoveProximity(pCurrLinePos))
+		if (!MeasuredMoveProximity(rInstruction))
 		{
 			rStatus.append("move line error");
 		}
@@ -176,7 +105,7 @@ bool Autonomous::Evaluate(std::string rStatement) {
 		break;
 
 	case AUTO_TOKEN_TURN:
-		if (!Turn(pCurrLinePos))
+		if (!Turn(rInstruction))
 		{
 			rStatus.append("turn error");
 		}
@@ -186,6 +115,17 @@ bool Autonomous::Evaluate(std::string rStatement) {
 		}
 		break;
 
+	case AUTO_TOKEN_ARC:
+		if (!Arc(rInstruction))
+		{
+			rStatus.append("arc error");
+		}
+		else
+		{
+			rStatus.append("arc");
+		}
+		break;
+
 	case AUTO_TOKEN_GEAR_RELEASE:
 		GearRelease();
 		rStatus.append("gear release");
@@ -206,6 +146,97 @@ bool Autonomous::Evaluate(std::string rStatement) {
 		rStatus.append("climber run");
 		break;
 
+	case AUTO_TOKEN_PARALLEL:
+		{
+			std::lock_guard<std::mutex> sync(mutexResponse);
+			iBranchCount = 0;
+		}
+
+		bParallel = true;
+		rStatus.append("parallel");
+		break;
+
+	case AUTO_TOKEN_JOIN:
+		bParallel = false;
+
+		if (!WaitForCommands(rInstruction.sParam[0] == "ALL", rInstruction.fParam[1]))
+		{
+			rStatus.append("join error");
+		}
+		else
+		{
+			rStatus.append("join");
+		}
+		break;
+
+	case AUTO_TOKEN_ARM:
+		Arm(rInstruction);
+		rStatus.append("arm");
+		break;
+
+	case AUTO_TOKEN_INTAKE:
+		Intake(rInstruction);
+		rStatus.append("intake");
+		break;
+
+	case AUTO_TOKEN_WAIT_UNTIL:
+		if(!WaitUntil(rInstruction))
+		{
+			rStatus.append("wait until timed out");
+		}
+		else
+		{
+			rStatus.append("wait until");
+		}
+		break;
+
+	case AUTO_TOKEN_IF:
+		// skip to the ELSE or ENDIF if the test fails
+
+		if(!AutoSensors::GetInstance()->Test(rInstruction.condition))
+		{
+			iJumpTo = rInstruction.iJump;
+		}
+
+		rStatus.append("if");
+		break;
+
+	case AUTO_TOKEN_ELSE:
+		// we ran the IF side, skip the ELSE side
+
+		iJumpTo = rInstruction.iJump;
+		rStatus.append("else");
+		break;
+
+	case AUTO_TOKEN_ENDIF:
+		break;
+
+	case AUTO_TOKEN_BLEND:
+		// the compiler already worked out which moves blend
+		break;
+
+	case AUTO_TOKEN_PATH:
+		if(!Path(rInstruction))
+		{
+			rStatus.append("path error");
+		}
+		else
+		{
+			rStatus.append("path");
+		}
+		break;
+
+	case AUTO_TOKEN_REPLAY:
+		if(!Replay(rInstruction))
+		{
+			rStatus.append("replay error");
+		}
+		else
+		{
+			rStatus.append("replay");
+		}
+		break;
+
 	default:
 		rStatus.append("unknown token");
 		break;
@@ -213,7 +244,7 @@ bool Autonomous::Evaluate(std::string rStatement) {
 
 	if(bReturn)
 	{
-		printf("%0.3lf %s\n", pDebugTimer->Get(), rStatement.c_str());
+		printf("%0.3lf %s\n", pDebugTimer->Get(), rInstruction.sText.c_str());
 	}
 
 	SmartDashboard::PutBoolean("bReturn", bReturn);
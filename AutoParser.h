@@ -27,6 +27,18 @@ typedef enum AUTO_COMMAND_TOKENS
 	AUTO_TOKEN_GEAR_HOLD,			//!< 	closes gear handler
 	AUTO_TOKEN_GEAR_HANG,			//!< 	gear hang macro
 	AUTO_TOKEN_CLIMBER,			    //!< 	moves climber a bit
+	AUTO_TOKEN_PARALLEL,			//!<_	send the following commands without waiting
+	AUTO_TOKEN_JOIN,				//!<_	join <ALL|ANY> (timeout) wait for the PARALLEL commands
+	AUTO_TOKEN_ARM,					//!<R	arm <FLOOR|DRIVE|RELEASE> (timeout) move the gear floor arm
+	AUTO_TOKEN_INTAKE,				//!<N	intake (speed) run the gear rollers, + in - out 0 stop
+	AUTO_TOKEN_WAIT_UNTIL,			//!<_	wait_until <sensor> <op> (value) (timeout)
+	AUTO_TOKEN_IF,					//!<_	if <sensor> <op> (value) run the lines up to ELSE or ENDIF
+	AUTO_TOKEN_ELSE,				//!<_	else
+	AUTO_TOKEN_ENDIF,				//!<_	endif
+	AUTO_TOKEN_BLEND,				//!<_	blend <ON|OFF> keep moving between MMOVE, PMOVE, TURN and ARC
+	AUTO_TOKEN_ARC,					//!<R	arc <speed> (radius:feet) (degrees) (timeout)
+	AUTO_TOKEN_REPLAY,				//!<_	replay <file> play back a teleop recording
+	AUTO_TOKEN_PATH,				//!<R	path <file> (timeout) follow a trajectory made by PathGen
 
 	AUTO_TOKEN_LAST
 } AUTO_COMMAND_TOKENS;
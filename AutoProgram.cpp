@@ -0,0 +1,702 @@
+/** \file
+ *  Autonomous script compiler
+ *
+ *  Turns the text of the script into AutoInstructions.  This used to happen
+ *  line by line every time a line was executed, now it happens once when the
+ *  script file changes.
+ */
+
+#include <AutoProgram.h>
+#include <AutoParser.h>
+#include <RobotParams.h>
+#include <math.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+// name, parameters required, where the command is sent (NULL if it runs in the
+// auto thread) and which parameter is its timeout (-1 if it does not report back)
+
+const AutoTokenInfo autoTokens[] = {
+		{ "MODE",		1,	NULL,					-1 },
+		{ "DEBUG",		1,	NULL,					-1 },
+		{ "MESSAGE",	0,	NULL,					-1 },
+		{ "BEGIN",		0,	NULL,					-1 },
+		{ "END",		0,	NULL,					-1 },
+		{ "DELAY",		1,	NULL,					-1 },	//!<(seconds)
+		{ "MOVE",		2,	DRIVETRAIN_QUEUE,		-1 },	//!<(left speed) (right speed)
+		{ "MMOVE",		3,	DRIVETRAIN_QUEUE,		2 },	//!<(speed) (distance:inches) (timeout)
+		{ "PMOVE",		3,	DRIVETRAIN_QUEUE,		2 },	//!<(speed) (distance:inches) (timeout)
+		{ "TURN",		2,	DRIVETRAIN_QUEUE,		1 },	//!<(degrees) (timeout)
+		{ "RGEAR",		0,	GEARINTAKE_QUEUE,		-1 },
+		{ "HGEAR",		0,	GEARINTAKE_QUEUE,		-1 },
+		{ "GEARM",		0,	NULL,					-1 },	// talks to two components and waits
+		{ "CLIMBER",	0,	CLIMBER_QUEUE,			-1 },
+		{ "PARALLEL",	0,	NULL,					-1 },
+		{ "JOIN",		2,	NULL,					-1 },	//!<(ALL|ANY) (timeout)
+		{ "ARM",		2,	GEARFLOORINTAKE_QUEUE,	1 },	//!<(FLOOR|DRIVE|RELEASE) (timeout)
+		{ "INTAKE",		1,	GEARFLOORINTAKE_QUEUE,	-1 },	//!<(speed, + in, - out)
+		{ "WAIT_UNTIL",	4,	NULL,					3 },	//!<(sensor) (< > =) (value) (timeout)
+		{ "IF",			3,	NULL,					-1 },	//!<(sensor) (< > =) (value)
+		{ "ELSE",		0,	NULL,					-1 },
+		{ "ENDIF",		0,	NULL,					-1 },
+		{ "BLEND",		1,	NULL,					-1 },	//!<(ON|OFF)
+		{ "ARC",		4,	DRIVETRAIN_QUEUE,		3 },	//!<(speed) (radius:feet) (degrees) (timeout)
+		{ "REPLAY",		1,	NULL,					-1 },	//!<(file)
+		{ "PATH",		2,	NULL,					1 },	//!<(file) (timeout)
+		{ "NOP",		0,	NULL,					-1 } };
+
+static_assert(sizeof(autoTokens)/sizeof(autoTokens[0]) == AUTO_TOKEN_LAST + 1, "autoTokens does not match AUTO_COMMAND_TOKENS");
+
+// how the sensors are written in the script, in AutoSensor order
+
+static const char *const szSensorNames[] = { "RANGE", "GEAR", "HEADING_ERROR", "TARGET" };
+
+static_assert(sizeof(szSensorNames)/sizeof(szSensorNames[0]) == AUTO_SENSOR_LAST, "szSensorNames does not match AutoSensor");
+
+AutoProgram::AutoProgram()
+{
+	uHash = 0;
+	iErrorLine = 0;
+	bInParallel = false;
+}
+
+uint32_t AutoProgram::Hash(const std::string &rText)
+{
+	// 32 bit FNV-1a, good enough to tell if the file really changed
+
+	uint32_t uReturn = 2166136261u;
+
+	for(unsigned int i = 0; i < rText.size(); i++)
+	{
+		uReturn ^= (uint8_t)rText[i];
+		uReturn *= 16777619u;
+	}
+
+	return(uReturn);
+}
+
+bool AutoProgram::Compile(const std::string &rText)
+{
+	istringstream scriptStream(rText);
+	string sLine;
+	int iLine = 0;
+
+	routines.clear();
+	warnings.clear();
+	iErrorLine = 0;
+	sError.clear();
+	uHash = Hash(rText);
+	bInParallel = false;
+	openBlocks.clear();
+
+	while(getline(scriptStream, sLine))
+	{
+		iLine++;
+
+		if(!CompileLine(sLine, iLine))
+		{
+			iErrorLine = iLine;
+			return(false);
+		}
+	}
+
+	if(bInParallel)
+	{
+		sError = "PARALLEL without JOIN";
+		iErrorLine = iLine;
+		return(false);
+	}
+
+	if(!openBlocks.empty())
+	{
+		sError = "IF without ENDIF";
+		iErrorLine = iLine;
+		return(false);
+	}
+
+	// a script with nothing in it is as bad as a script with a typo
+
+	if(routines.empty())
+	{
+		sError = "no instructions";
+		iErrorLine = iLine;
+		return(false);
+	}
+
+	for(unsigned int i = 0; i < routines.size(); i++)
+	{
+		if(routines[i].instructions.empty())
+		{
+			sError = "MODE " + std::to_string(routines[i].iMode) + " is empty";
+			iErrorLine = routines[i].iLine;
+			return(false);
+		}
+
+		LinkSegments(routines[i]);
+	}
+
+	return(true);
+}
+
+static bool IsSegment(int iCommand)
+{
+	return((iCommand == AUTO_TOKEN_MMOVE) || (iCommand == AUTO_TOKEN_MPROXIMITY) ||
+			(iCommand == AUTO_TOKEN_TURN) || (iCommand == AUTO_TOKEN_ARC));
+}
+
+void AutoProgram::LinkSegments(AutoRoutine &rRoutine)
+{
+	std::vector<AutoInstruction> &rInstructions = rRoutine.instructions;
+	bool bBlending = false;
+	bool bParallel = false;
+
+	// look ahead from each motion command to the next thing the script does,
+	// only a move that is followed right away by another move can keep going
+
+	for(unsigned int i = 0; i < rInstructions.size(); i++)
+	{
+		AutoInstruction &rThis = rInstructions[i];
+		unsigned int iNext = i + 1;
+
+		if(rThis.iCommand == AUTO_TOKEN_BLEND)
+		{
+			bBlending = (rThis.sParam[0] == "ON");
+		}
+		else if(rThis.iCommand == AUTO_TOKEN_PARALLEL)
+		{
+			bParallel = true;
+		}
+		else if(rThis.iCommand == AUTO_TOKEN_JOIN)
+		{
+			bParallel = false;
+		}
+
+		if(!bBlending || bParallel || !IsSegment(rThis.iCommand))
+		{
+			continue;
+		}
+
+		// printing does not take any time
+
+		while((iNext < rInstructions.size()) && ((rInstructions[iNext].iCommand == AUTO_TOKEN_MESSAGE) ||
+				(rInstructions[iNext].iCommand == AUTO_TOKEN_DEBUG)))
+		{
+			iNext++;
+		}
+
+		if((iNext >= rInstructions.size()) || !IsSegment(rInstructions[iNext].iCommand))
+		{
+			continue;
+		}
+
+		const AutoInstruction &rNext = rInstructions[iNext];
+
+		rThis.bBlend = true;
+
+		// two moves the same way keep rolling at the slower speed, a PMOVE
+		// measures its range as it starts so it has to start from a stop
+
+		if((rThis.iCommand != AUTO_TOKEN_TURN) &&
+				((rNext.iCommand == AUTO_TOKEN_MMOVE) || (rNext.iCommand == AUTO_TOKEN_ARC)) &&
+				((rThis.fParam[0] > 0.0) == (rNext.fParam[0] > 0.0)))
+		{
+			rThis.fExitSpeed = std::min(fabs(rThis.fParam[0]), fabs(rNext.fParam[0]));
+
+			if(rThis.fParam[0] < 0.0)
+			{
+				rThis.fExitSpeed = -rThis.fExitSpeed;
+			}
+		}
+	}
+}
+
+const AutoRoutine *AutoProgram::FindRoutine(int iMode) const
+{
+	for(unsigned int i = 0; i < routines.size(); i++)
+	{
+		if(routines[i].iMode == iMode)
+		{
+			return(&routines[i]);
+		}
+	}
+
+	return(NULL);
+}
+
+bool AutoProgram::CompileLine(const std::string &rLine, int iLine)
+{
+	AutoInstruction instruction;
+	char *pToken;
+	char *pCurrLinePos;
+	int iCommand;
+
+	// comments and blank lines do not make instructions
+
+	if(rLine.empty() || (rLine[0] == sComment))
+	{
+		return(true);
+	}
+
+	// strtok_r writes into the string so work on a copy
+
+	string sWork(rLine);
+	pCurrLinePos = (char *)sWork.c_str();
+	pToken = strtok_r(pCurrLinePos, szDelimiters, &pCurrLinePos);
+
+	if(pToken == NULL)
+	{
+		return(true);
+	}
+
+	// which command is this?  it has to match exactly, MMOVEX is a typo not an MMOVE
+
+	for(iCommand = AUTO_TOKEN_MODE; iCommand < AUTO_TOKEN_LAST; iCommand++)
+	{
+		if(!strcmp(pToken, autoTokens[iCommand].szName))
+		{
+			break;
+		}
+	}
+
+	if(iCommand == AUTO_TOKEN_LAST)
+	{
+		sError = "unknown token ";
+		sError.append(pToken);
+		return(false);
+	}
+
+	instruction.iCommand = iCommand;
+	instruction.iLine = iLine;
+	instruction.szQueue = autoTokens[iCommand].szQueue;
+	instruction.iParamCount = 0;
+	instruction.sText = rLine;
+	instruction.sArgs = pCurrLinePos;
+	instruction.iJump = -1;
+	instruction.bBlend = false;
+	instruction.fExitSpeed = 0.0;
+	instruction.condition.iSensor = AUTO_SENSOR_LAST;
+	instruction.condition.cCompare = '=';
+	instruction.condition.fValue = 0.0;
+
+	// pick up the parameters, whatever they are
+
+	while((instruction.iParamCount < AUTONOMOUS_MAX_PARAMS) &&
+			((pToken = strtok_r(pCurrLinePos, szDelimiters, &pCurrLinePos)) != NULL))
+	{
+		instruction.sParam[instruction.iParamCount] = pToken;
+		instruction.fParam[instruction.iParamCount] = atof(pToken);
+		instruction.iParamCount++;
+	}
+
+	for(int i = instruction.iParamCount; i < AUTONOMOUS_MAX_PARAMS; i++)
+	{
+		instruction.fParam[i] = 0.0;
+	}
+
+	// MODE names and messages can be as long as they like, nothing else should be
+
+	if((iCommand != AUTO_TOKEN_MODE) && (iCommand != AUTO_TOKEN_MESSAGE) &&
+			((instruction.iParamCount > autoTokens[iCommand].iParams) ||
+			 (strtok_r(pCurrLinePos, szDelimiters, &pCurrLinePos) != NULL)))
+	{
+		warnings.push_back("line " + std::to_string(iLine) + ": extra parameters ignored");
+	}
+
+	if(instruction.iParamCount < autoTokens[iCommand].iParams)
+	{
+		sError = "missing parameter for ";
+		sError.append(autoTokens[iCommand].szName);
+		return(false);
+	}
+
+	if(autoTokens[iCommand].iTimeoutParam >= 0)
+	{
+		instruction.fTimeout = instruction.fParam[autoTokens[iCommand].iTimeoutParam];
+	}
+	else
+	{
+		instruction.fTimeout = 0.0;
+	}
+
+	if(!CheckParams(instruction) || !CheckParallel(instruction) || !CheckCondition(instruction))
+	{
+		return(false);
+	}
+
+	// a MODE line starts a new routine, it is not an instruction itself
+
+	if(iCommand == AUTO_TOKEN_MODE)
+	{
+		if(bInParallel)
+		{
+			sError = "PARALLEL without JOIN";
+			return(false);
+		}
+
+		if(!openBlocks.empty())
+		{
+			sError = "IF without ENDIF";
+			return(false);
+		}
+
+		AutoRoutine routine;
+
+		routine.iMode = (int)instruction.fParam[0];
+		routine.iLine = iLine;
+
+		if(FindRoutine(routine.iMode))
+		{
+			sError = "duplicate MODE " + instruction.sParam[0];
+			return(false);
+		}
+
+		for(int i = 1; i < instruction.iParamCount; i++)
+		{
+			if(i > 1)
+			{
+				routine.sName.append(" ");
+			}
+
+			routine.sName.append(instruction.sParam[i]);
+		}
+
+		routines.push_back(routine);
+		return(true);
+	}
+
+	// anything before the first MODE is routine 0
+
+	if(routines.empty())
+	{
+		AutoRoutine routine;
+
+		routine.iMode = 0;
+		routine.iLine = iLine;
+		routines.push_back(routine);
+	}
+
+	if(!CheckBlocks(instruction))
+	{
+		return(false);
+	}
+
+	routines.back().instructions.push_back(instruction);
+	return(true);
+}
+
+static bool IsWordParam(int iCommand, int iParam)
+{
+	switch(iCommand)
+	{
+	case AUTO_TOKEN_MODE:
+		return(iParam > 0);
+
+	case AUTO_TOKEN_MESSAGE:
+	case AUTO_TOKEN_REPLAY:
+		return(true);
+
+	case AUTO_TOKEN_ARM:
+	case AUTO_TOKEN_JOIN:
+	case AUTO_TOKEN_BLEND:
+	case AUTO_TOKEN_PATH:
+		return(iParam == 0);
+
+	case AUTO_TOKEN_WAIT_UNTIL:
+	case AUTO_TOKEN_IF:
+		return(iParam < 2);
+
+	default:
+		return(false);
+	}
+}
+
+bool AutoProgram::CheckParams(const AutoInstruction &rInstruction)
+{
+	char *pEnd;
+
+	// atof turns a typo into 0.0 and the robot happily drives 0 feet
+
+	for(int i = 0; i < rInstruction.iParamCount; i++)
+	{
+		if(!IsWordParam(rInstruction.iCommand, i))
+		{
+			strtod(rInstruction.sParam[i].c_str(), &pEnd);
+
+			if(*pEnd != '\0')
+			{
+				sError = "\"" + rInstruction.sParam[i] + "\" is not a number";
+				return(false);
+			}
+		}
+	}
+
+	// words that have to be one of a few choices, and numbers with limits
+
+	switch(rInstruction.iCommand)
+	{
+	case AUTO_TOKEN_MOVE:
+		if((fabs(rInstruction.fParam[0]) > MAX_VELOCITY_PARAM) ||
+				(fabs(rInstruction.fParam[1]) > MAX_VELOCITY_PARAM))
+		{
+			sError = "MOVE speeds must be between -1 and 1";
+			return(false);
+		}
+		break;
+
+	case AUTO_TOKEN_MMOVE:
+	case AUTO_TOKEN_MPROXIMITY:
+		if(fabs(rInstruction.fParam[0]) > MAX_VELOCITY_PARAM)
+		{
+			sError = "speed must be between -1 and 1";
+			return(false);
+		}
+
+		if(fabs(rInstruction.fParam[1]) > MAX_DISTANCE_PARAM)
+		{
+			sError = "distance is too far";
+			return(false);
+		}
+
+		if(rInstruction.fParam[2] <= 0.0)
+		{
+			sError = "timeout must be more than 0";
+			return(false);
+		}
+		break;
+
+	case AUTO_TOKEN_TURN:
+		if(rInstruction.fParam[1] <= 0.0)
+		{
+			sError = "timeout must be more than 0";
+			return(false);
+		}
+		break;
+
+	case AUTO_TOKEN_ARC:
+		if((fabs(rInstruction.fParam[0]) > MAX_VELOCITY_PARAM) || (rInstruction.fParam[0] == 0.0))
+		{
+			sError = "speed must be between -1 and 1 and not 0";
+			return(false);
+		}
+
+		if(rInstruction.fParam[1] <= 0.0)
+		{
+			sError = "radius must be more than 0";
+			return(false);
+		}
+
+		if(rInstruction.fParam[3] <= 0.0)
+		{
+			sError = "timeout must be more than 0";
+			return(false);
+		}
+		break;
+
+	case AUTO_TOKEN_WAIT_UNTIL:
+		if(rInstruction.fParam[3] <= 0.0)
+		{
+			sError = "timeout must be more than 0";
+			return(false);
+		}
+		break;
+
+	case AUTO_TOKEN_DELAY:
+		if(rInstruction.fParam[0] < 0.0)
+		{
+			sError = "DELAY can not be negative";
+			return(false);
+		}
+		break;
+
+	case AUTO_TOKEN_ARM:
+		if((rInstruction.sParam[0] != "FLOOR") && (rInstruction.sParam[0] != "DRIVE") &&
+				(rInstruction.sParam[0] != "RELEASE"))
+		{
+			sError = "ARM must be FLOOR, DRIVE or RELEASE";
+			return(false);
+		}
+
+		if(rInstruction.fParam[1] <= 0.0)
+		{
+			sError = "timeout must be more than 0";
+			return(false);
+		}
+		break;
+
+	case AUTO_TOKEN_JOIN:
+		if((rInstruction.sParam[0] != "ALL") && (rInstruction.sParam[0] != "ANY"))
+		{
+			sError = "JOIN must be ALL or ANY";
+			return(false);
+		}
+		break;
+
+	case AUTO_TOKEN_REPLAY:
+		if(rInstruction.sParam[0].find('/') != std::string::npos)
+		{
+			sError = "REPLAY file must be in the script directory";
+			return(false);
+		}
+		break;
+
+	case AUTO_TOKEN_PATH:
+		if(rInstruction.sParam[0].find('/') != std::string::npos)
+		{
+			sError = "PATH file must be in the script directory";
+			return(false);
+		}
+
+		if(rInstruction.fParam[1] <= 0.0)
+		{
+			sError = "timeout must be more than 0";
+			return(false);
+		}
+		break;
+
+	case AUTO_TOKEN_BLEND:
+		if((rInstruction.sParam[0] != "ON") && (rInstruction.sParam[0] != "OFF"))
+		{
+			sError = "BLEND must be ON or OFF";
+			return(false);
+		}
+		break;
+
+	default:
+		break;
+	}
+
+	return(true);
+}
+
+bool AutoProgram::CheckParallel(const AutoInstruction &rInstruction)
+{
+	if(rInstruction.iCommand == AUTO_TOKEN_PARALLEL)
+	{
+		if(bInParallel)
+		{
+			sError = "PARALLEL inside PARALLEL";
+			return(false);
+		}
+
+		bInParallel = true;
+		parallelQueues.clear();
+	}
+	else if(rInstruction.iCommand == AUTO_TOKEN_JOIN)
+	{
+		if(!bInParallel)
+		{
+			sError = "JOIN without PARALLEL";
+			return(false);
+		}
+
+		bInParallel = false;
+	}
+	else if(bInParallel)
+	{
+		// every branch has to be a message to a component, and a component only
+		// does one thing at a time so it can only have one branch
+
+		if(rInstruction.szQueue == NULL)
+		{
+			sError = autoTokens[rInstruction.iCommand].szName;
+			sError.append(" can not run in PARALLEL");
+			return(false);
+		}
+
+		for(unsigned int i = 0; i < parallelQueues.size(); i++)
+		{
+			if(!strcmp(parallelQueues[i], rInstruction.szQueue))
+			{
+				sError = "two PARALLEL commands for ";
+				sError.append(rInstruction.szQueue);
+				return(false);
+			}
+		}
+
+		parallelQueues.push_back(rInstruction.szQueue);
+	}
+
+	return(true);
+}
+
+bool AutoProgram::CheckCondition(AutoInstruction &rInstruction)
+{
+	if((rInstruction.iCommand != AUTO_TOKEN_WAIT_UNTIL) && (rInstruction.iCommand != AUTO_TOKEN_IF))
+	{
+		return(true);
+	}
+
+	for(rInstruction.condition.iSensor = 0; rInstruction.condition.iSensor < AUTO_SENSOR_LAST;
+			rInstruction.condition.iSensor++)
+	{
+		if(rInstruction.sParam[0] == szSensorNames[rInstruction.condition.iSensor])
+		{
+			break;
+		}
+	}
+
+	if(rInstruction.condition.iSensor == AUTO_SENSOR_LAST)
+	{
+		sError = "unknown sensor " + rInstruction.sParam[0];
+		return(false);
+	}
+
+	if((rInstruction.sParam[1] != "<") && (rInstruction.sParam[1] != ">") && (rInstruction.sParam[1] != "="))
+	{
+		sError = "compare with <, > or =";
+		return(false);
+	}
+
+	rInstruction.condition.cCompare = rInstruction.sParam[1][0];
+	rInstruction.condition.fValue = rInstruction.fParam[2];
+	return(true);
+}
+
+bool AutoProgram::CheckBlocks(AutoInstruction &rInstruction)
+{
+	std::vector<AutoInstruction> &rInstructions = routines.back().instructions;
+	int iHere = (int)rInstructions.size();
+
+	// IF jumps past its ELSE (or to its ENDIF) when the test fails, ELSE jumps
+	// to the ENDIF when we ran the IF side
+
+	switch(rInstruction.iCommand)
+	{
+	case AUTO_TOKEN_IF:
+		openBlocks.push_back(iHere);
+		break;
+
+	case AUTO_TOKEN_ELSE:
+		if(openBlocks.empty() || (rInstructions[openBlocks.back()].iCommand != AUTO_TOKEN_IF))
+		{
+			sError = "ELSE without IF";
+			return(false);
+		}
+
+		rInstructions[openBlocks.back()].iJump = iHere + 1;
+		openBlocks.back() = iHere;
+		break;
+
+	case AUTO_TOKEN_ENDIF:
+		if(openBlocks.empty())
+		{
+			sError = "ENDIF without IF";
+			return(false);
+		}
+
+		rInstructions[openBlocks.back()].iJump = iHere;
+		openBlocks.pop_back();
+		break;
+
+	default:
+		break;
+	}
+
+	return(true);
+}
@@ -0,0 +1,139 @@
+/** \file
+ * Compiled form of the autonomous script.
+ *
+ * The script file is parsed once, when it changes, into a list of
+ * instructions with their parameters already converted to numbers.  The
+ * autonomous thread runs the instructions without touching the file or
+ * tokenizing strings.  Nothing in here depends on WPILib so the same parser
+ * can be built on a laptop.
+ *
+ * One file can hold several routines, each starting with a MODE line:
+ *
+ *     MODE 1 left side
+ *     BEGIN
+ *     ...
+ *     END
+ *
+ * Lines before the first MODE (or a file with no MODE at all) make routine 0.
+ *
+ * Commands for different components can run at the same time:
+ *
+ *     PARALLEL
+ *     MMOVE 0.75 5.0 10.0
+ *     ARM RELEASE 2.0
+ *     JOIN ALL 6.0
+ *
+ * Each line between PARALLEL and JOIN is sent without waiting.  JOIN waits
+ * for ALL of them or ANY of them to report back, for at most its timeout.  A
+ * branch that has a timeout of its own (the last MMOVE parameter, ARM's
+ * second) gives up after that long even if the JOIN would wait longer.  ARM
+ * reports back once the arm has got to the position.
+ *
+ * Sensors can end a step or pick which lines run:
+ *
+ *     WAIT_UNTIL RANGE < 24 3.0
+ *     IF GEAR = 1
+ *     ...
+ *     ELSE
+ *     ...
+ *     ENDIF
+ *
+ * The sensors are RANGE (inches), GEAR (limit switch), HEADING_ERROR (degrees)
+ * and TARGET (Pixy), see AutoSensors.h.  WAIT_UNTIL gives up after its timeout
+ * and the script goes on, an IF after it can check whether it got there.
+ *
+ * ARC (speed) (radius) (degrees) (timeout) drives a curve, the degrees are how
+ * far the heading changes, positive the same way as TURN.
+ *
+ * REPLAY (file) plays back a recording of the driver made in teleop, the file
+ * is in the same directory as the script.
+ *
+ * PATH (file) (timeout) follows a trajectory made by tools/PathGen, also kept
+ * next to the script.  It starts from wherever the robot is, so the path's
+ * first waypoint is the robot's position and heading when the PATH starts.
+ *
+ * After BLEND ON, an MMOVE, PMOVE, TURN or ARC that is followed straight away by
+ * another one does not stop the drivetrain when it gets there.  Two moves the
+ * same way (MMOVE or ARC after MMOVE, PMOVE or ARC) hand over at the slower of
+ * their speeds, anything else hands over
+ * at zero without shutting the Talons off.  BLEND OFF goes back to stopping.
+ */
+
+#ifndef AUTOPROGRAM_H
+#define AUTOPROGRAM_H
+
+#include <AutoSensors.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+const int AUTONOMOUS_MAX_PARAMS = 4;
+
+//from 2014
+const float MAX_VELOCITY_PARAM = 1.0;
+const float MAX_DISTANCE_PARAM = 100.0;
+
+///One line of the script, parsed and ready to execute
+struct AutoInstruction {
+	int iCommand;								//!< one of AUTO_COMMAND_TOKENS
+	int iLine;									//!< line number in the script file (from 1)
+	int iParamCount;							//!< number of parameters found on the line
+	const char *szQueue;						//!< component the command goes to, NULL if it runs in the auto thread
+	float fTimeout;								//!< how long the component may take, 0 if it does not report back
+	float fParam[AUTONOMOUS_MAX_PARAMS];		//!< parameters converted with atof
+	std::string sParam[AUTONOMOUS_MAX_PARAMS];	//!< parameters as written
+	std::string sArgs;							//!< everything after the token (MESSAGE)
+	std::string sText;							//!< the whole line, for the dashboard
+	AutoCondition condition;					//!< WAIT_UNTIL and IF, what to test
+	int iJump;									//!< IF and ELSE, instruction to go to if not running the next one
+	bool bBlend;								//!< motion that goes straight into more motion, do not stop
+	float fExitSpeed;							//!< speed to be going when it hands over, signed like fParam[0]
+};
+
+///One MODE block of the script
+struct AutoRoutine {
+	int iMode;									//!< number from the MODE line
+	int iLine;									//!< line of the MODE statement
+	std::string sName;							//!< anything after the mode number
+	std::vector<AutoInstruction> instructions;
+};
+
+class AutoProgram
+{
+public:
+	AutoProgram();
+
+	bool Compile(const std::string &rText);	//!< parse a whole script, false on the first error
+	const AutoRoutine *FindRoutine(int iMode) const;
+	static uint32_t Hash(const std::string &rText);
+
+	std::vector<AutoRoutine> routines;
+	uint32_t uHash;				//!< hash of the text this program was compiled from
+	int iErrorLine;				//!< line of the first error, 0 if none
+	std::string sError;			//!< what was wrong with that line
+	std::vector<std::string> warnings;	//!< things that compile but are probably wrong
+
+private:
+	bool CompileLine(const std::string &rLine, int iLine);
+	bool CheckParams(const AutoInstruction &rInstruction);
+	bool CheckParallel(const AutoInstruction &rInstruction);
+	bool CheckCondition(AutoInstruction &rInstruction);
+	bool CheckBlocks(AutoInstruction &rInstruction);
+	void LinkSegments(AutoRoutine &rRoutine);
+
+	bool bInParallel;							//!< between PARALLEL and JOIN
+	std::vector<int> openBlocks;				//!< IF or ELSE instructions still waiting for their ENDIF
+	std::vector<const char *> parallelQueues;	//!< components already given a branch
+};
+
+///What the compiler knows about each token
+struct AutoTokenInfo {
+	const char *szName;
+	int iParams;				//!< parameters that must be present
+	const char *szQueue;		//!< where the command is sent, NULL if it runs in the auto thread
+	int iTimeoutParam;			//!< which parameter is the timeout, -1 if the command does not report back
+};
+
+extern const AutoTokenInfo autoTokens[];
+
+#endif  // AUTOPROGRAM_H
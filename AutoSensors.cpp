@@ -0,0 +1,71 @@
+/** \file
+ * Sensor readings published for the autonomous script.
+ *
+ * Publish is called from the component threads every control cycle so it has
+ * to be cheap, it only takes the lock and wakes the script thread if it is
+ * waiting on something.
+ */
+
+#include <AutoSensors.h>
+
+AutoSensors *AutoSensors::GetInstance()
+{
+	static AutoSensors sensors;
+
+	return(&sensors);
+}
+
+AutoSensors::AutoSensors()
+{
+	for(int i = 0; i < AUTO_SENSOR_LAST; i++)
+	{
+		fReading[i] = 0.0;
+		bValid[i] = false;
+	}
+
+	iWaiters = 0;
+}
+
+void AutoSensors::Publish(AutoSensor eSensor, float fValue)
+{
+	std::lock_guard<std::mutex> sync(mutexSensors);
+
+	fReading[eSensor] = fValue;
+	bValid[eSensor] = true;
+
+	if(iWaiters > 0)
+	{
+		published.notify_all();
+	}
+}
+
+bool AutoSensors::TestLocked(const AutoCondition &rCondition) const
+{
+	// nothing published yet is never true, the owner may not be running
+
+	return(bValid[rCondition.iSensor] && rCondition.Test(fReading[rCondition.iSensor]));
+}
+
+bool AutoSensors::Test(const AutoCondition &rCondition)
+{
+	std::lock_guard<std::mutex> sync(mutexSensors);
+
+	return(TestLocked(rCondition));
+}
+
+bool AutoSensors::WaitUntil(const AutoCondition &rCondition, float fTimeout)
+{
+	std::unique_lock<std::mutex> lock(mutexSensors);
+	std::chrono::steady_clock::time_point deadline;
+	bool bReturn;
+
+	deadline = std::chrono::steady_clock::now() +
+			std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+					std::chrono::duration<float>(fTimeout));
+
+	iWaiters++;
+	bReturn = published.wait_until(lock, deadline, [this, &rCondition] { return TestLocked(rCondition); });
+	iWaiters--;
+
+	return(bReturn);
+}
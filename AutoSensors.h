@@ -0,0 +1,76 @@
+/** \file
+ * Sensor readings published for the autonomous script.
+ *
+ * The component that owns a sensor publishes it every time it reads it, which
+ * is every pass of its control loop.  WAIT_UNTIL sleeps until one of those
+ * publishes makes its condition true, so it ends on the cycle the robot gets
+ * there instead of on the next poll.  IF tests the last value published.
+ *
+ * Nothing in here depends on WPILib, the script compiler uses the names.
+ */
+
+#ifndef AUTOSENSORS_H
+#define AUTOSENSORS_H
+
+#include <math.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+///Readings a script can test
+typedef enum AutoSensor
+{
+	AUTO_SENSOR_RANGE,				//!<	ultrasonic range, inches (Drivetrain)
+	AUTO_SENSOR_GEAR,				//!<	gear limit switch, 1 closed 0 open (GearFloorIntake)
+	AUTO_SENSOR_HEADING_ERROR,		//!<	degrees either way from the last TURN or MMOVE heading (Drivetrain)
+	AUTO_SENSOR_TARGET,				//!<	Pixy sees the target, 1 yes 0 no (Drivetrain)
+	AUTO_SENSOR_LAST
+} AutoSensor;
+
+///A test of one sensor, compiled from "RANGE < 24"
+struct AutoCondition {
+	int iSensor;			//!< one of AutoSensor
+	char cCompare;			//!< '<', '>' or '='
+	float fValue;
+
+	bool Test(float fReading) const
+	{
+		switch(cCompare)
+		{
+		case '<':
+			return(fReading < fValue);
+
+		case '>':
+			return(fReading > fValue);
+
+		default:
+			// most of the readings we compare with = are 0 or 1
+
+			return(fabs(fReading - fValue) < 0.5);
+		}
+	}
+};
+
+class AutoSensors
+{
+public:
+	static AutoSensors *GetInstance();
+
+	void Publish(AutoSensor eSensor, float fValue);
+	bool Test(const AutoCondition &rCondition);
+	bool WaitUntil(const AutoCondition &rCondition, float fTimeout);
+
+private:
+	AutoSensors();
+
+	bool TestLocked(const AutoCondition &rCondition) const;
+
+	std::mutex mutexSensors;
+	std::condition_variable published;
+	float fReading[AUTO_SENSOR_LAST];
+	bool bValid[AUTO_SENSOR_LAST];		//!< false until the owner publishes the first time
+	int iWaiters;						//!< skip the notify when nobody is waiting
+};
+
+#endif  // AUTOSENSORS_H
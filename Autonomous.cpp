@@ -12,7 +12,10 @@
 #include "WPILib.h"
 #include <string.h>
 #include <stdlib.h>
+#include <errno.h>
+#include <time.h>
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <string>
@@ -20,141 +23,406 @@
 
 //Robot
 #include <RobotParams.h>
+#include <Timespec.h>
 
 using namespace std;
 
 extern "C" {
 }
 
-bool Autonomous::CommandResponse(const char *szQueueName) {
+void Autonomous::SendCommand(const char *szQueueName, bool bResponse) {
 	int iPipeXmt;
-	bool bReturn = true;
+	AutoBranch *pBranch;
 
 	iPipeXmt = open(szQueueName, O_WRONLY);
 	wpi_assert(iPipeXmt > 0);
 
-	bReceivedCommandResponse = false;
+	// remember the command before it goes out so a quick response finds it
+
+	{
+		std::lock_guard<std::mutex> sync(mutexResponse);
+
+		if(!bParallel)
+		{
+			iBranchCount = 0;
+		}
+
+		wpi_assert(iBranchCount < AUTONOMOUS_MAX_BRANCHES);
+
+		pBranch = &branches[iBranchCount++];
+		pBranch->uReplyId = ++uLastReplyId;
+		pBranch->szQueueName = szQueueName;
+		pBranch->bResponse = bResponse;
+		pBranch->bComplete = !bResponse;
+		pBranch->bTimedOut = false;
+		pBranch->result = COMMAND_AUTONOMOUS_RESPONSE_OK;
+		pBranch->deadline = std::chrono::steady_clock::time_point::max();
+		pBranch->iTimelineEntry = bResponse ? iTimelineEntry : -1;
+
+		if(bResponse && (fBranchTimeout > 0.0))
+		{
+			pBranch->deadline = std::chrono::steady_clock::now() +
+					std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+							std::chrono::duration<float>(fBranchTimeout + AUTONOMOUS_BRANCH_GRACE));
+		}
+
+		Message.uReplyId = pBranch->uReplyId;
+	}
+
 	Message.replyQ = AUTONOMOUS_QUEUE;
 	write(iPipeXmt, (char*) &Message, sizeof(RobotMessage));
 	close(iPipeXmt);
 
-	while (!bReceivedCommandResponse)
+	// how long from the driver station enabling us to the first thing that moves?
+
+	if(!bFirstCommandSent && (Message.command != COMMAND_AUTONOMOUS_RUN) &&
+			(Message.command != COMMAND_AUTONOMOUS_COMPLETE))
+	{
+		double fNow = Timer::GetFPGATimestamp();
+
+		bFirstCommandSent = true;
+		printf("Auto start latency %0.3lf ms (%0.3lf ms wake, %0.3lf ms to first command)\n",
+				(fNow - fEnableTime) * 1000.0, (fWakeTime - fEnableTime) * 1000.0,
+				(fNow - fWakeTime) * 1000.0);
+		SmartDashboard::PutNumber("Auto Start Latency ms", (fNow - fEnableTime) * 1000.0);
+	}
+}
+
+void Autonomous::CommandComplete(const RobotMessage &rResponse) {
+	std::lock_guard<std::mutex> sync(mutexResponse);
+
+	// a response for a command we already gave up on is ignored
+
+	for(int i = 0; i < iBranchCount; i++)
+	{
+		if((branches[i].uReplyId == rResponse.uReplyId) && !branches[i].bComplete)
+		{
+			branches[i].bComplete = true;
+			branches[i].result = rResponse.command;
+
+			if(branches[i].iTimelineEntry >= 0)
+			{
+				AutoTimelineEntry *pEntry = &timeline[branches[i].iTimelineEntry];
+
+				pEntry->fAcked = rResponse.params.response.fReceived -
+						(tScriptStart.tv_sec + tScriptStart.tv_nsec / 1.0e9);
+				pEntry->fCompleted = ScriptTime();
+				pEntry->eReason = (rResponse.command == COMMAND_AUTONOMOUS_RESPONSE_ERROR) ?
+						AUTO_COMPLETE_ERROR : rResponse.params.response.eReason;
+			}
+
+			responseReady.notify_all();
+			break;
+		}
+	}
+}
+
+bool Autonomous::WaitForCommands(bool bAll, float fTimeout) {
+	std::unique_lock<std::mutex> lock(mutexResponse);
+	std::chrono::steady_clock::time_point now;
+	std::chrono::steady_clock::time_point nextDeadline;
+	std::chrono::steady_clock::time_point joinDeadline = std::chrono::steady_clock::time_point::max();
+	int iWaiting;
+	int iFinished;
+	bool bReturn = true;
+
+	if(fTimeout > 0.0)
+	{
+		joinDeadline = std::chrono::steady_clock::now() +
+				std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+						std::chrono::duration<float>(fTimeout));
+	}
+
+	// sleep until a response arrives or the nearest deadline passes
+
+	while(true)
+	{
+		now = std::chrono::steady_clock::now();
+		nextDeadline = joinDeadline;
+		iWaiting = 0;
+		iFinished = 0;
+
+		for(int i = 0; i < iBranchCount; i++)
+		{
+			if(!branches[i].bResponse)
+			{
+				continue;
+			}
+
+			if(!branches[i].bComplete && (now >= branches[i].deadline))
+			{
+				branches[i].bComplete = true;
+				branches[i].bTimedOut = true;
+
+				if(branches[i].iTimelineEntry >= 0)
+				{
+					timeline[branches[i].iTimelineEntry].fCompleted = ScriptTime();
+					timeline[branches[i].iTimelineEntry].eReason = AUTO_COMPLETE_NO_RESPONSE;
+				}
+			}
+
+			if(branches[i].bComplete)
+			{
+				iFinished++;
+			}
+			else
+			{
+				iWaiting++;
+				nextDeadline = std::min(nextDeadline, branches[i].deadline);
+			}
+		}
+
+		if((iWaiting == 0) || (!bAll && (iFinished > 0)))
+		{
+			break;
+		}
+
+		if(now >= joinDeadline)
+		{
+			printf("%0.3lf JOIN timed out, %d still running\n", pDebugTimer->Get(), iWaiting);
+			bReturn = false;
+			break;
+		}
+
+		if(nextDeadline == std::chrono::steady_clock::time_point::max())
+		{
+			responseReady.wait(lock);
+		}
+		else
+		{
+			responseReady.wait_until(lock, nextDeadline);
+		}
+	}
+
+	for(int i = 0; i < iBranchCount; i++)
 	{
-		//purposefully empty
+		if(branches[i].bTimedOut)
+		{
+			printf("%0.3lf %s timed out\n", pDebugTimer->Get(), branches[i].szQueueName);
+			bReturn = false;
+		}
+		else if(branches[i].bComplete && (branches[i].result == COMMAND_AUTONOMOUS_RESPONSE_ERROR))
+		{
+			bReturn = false;
+		}
 	}
 
+	// anything still running is forgotten, its response will be ignored
+
+	for(int i = 0; i < iBranchCount; i++)
+	{
+		if(!branches[i].bComplete && (branches[i].iTimelineEntry >= 0))
+		{
+			timeline[branches[i].iTimelineEntry].fCompleted = ScriptTime();
+			timeline[branches[i].iTimelineEntry].eReason = AUTO_COMPLETE_NO_RESPONSE;
+		}
+	}
+
+	iBranchCount = 0;
+
 	if(iAutoDebugMode)
 	{
 		printf("%0.3lf Response received\n", pDebugTimer->Get());
 	}
 
-	if (ReceivedCommand == COMMAND_AUTONOMOUS_RESPONSE_OK)
+	if (bReturn)
 	{
 		SmartDashboard::PutString("Auto Status","auto ok");
-		bReturn = true;
 	}
-	else if (ReceivedCommand == COMMAND_AUTONOMOUS_RESPONSE_ERROR)
+	else
 	{
 		SmartDashboard::PutString("Auto Status","EARLY DEATH!");
 		PRINTAUTOERROR;
-		bReturn = false;
 	}
 
 	return bReturn;
 }
 
+bool Autonomous::CommandResponse(const char *szQueueName) {
+	SendCommand(szQueueName, true);
+
+	// in a PARALLEL block the JOIN does the waiting
 
-//UNTESTED
-//USAGE: MultiCommandResponse({DRIVETRAIN_QUEUE, CONVEYOR_QUEUE}, {COMMAND_DRIVETRAIN_STRAIGHT, COMMAND_CONVEYOR_SEEK_TOTE});
-bool Autonomous::MultiCommandResponse(vector<char*> szQueueNames, vector<MessageCommand> commands) {
-	//wait for several commands at once
-	//check that queue list is as long as command list
-	if(szQueueNames.size() != commands.size())
+	if(bParallel)
 	{
-		SmartDashboard::PutString("Auto Status","MULTICOMMAND error!");
-		return false;
+		return (true);
 	}
-	bool bReturn = true;
-	int iPipeXmt;
-	uResponseCount = 0;
-	//vector<int> iPipesXmt = new vector<int>();
 
-	bReceivedCommandResponse = false;
+	return (WaitForCommands(true, 0.0));
+}
+
+bool Autonomous::CommandNoResponse(const char *szQueueName) {
+	SendCommand(szQueueName, false);
+	return (true);
+}
+
+void Autonomous::StartScriptClock()
+{
+	// OnStateChange ran a little after the main task saw the enable, back the
+	// monotonic clock up to when that happened so everything counts from there
+
+	clock_gettime(CLOCK_MONOTONIC, &tScriptStart);
+	TimespecAdd(tScriptStart, -(Timer::GetFPGATimestamp() - fEnableTime));
+
+	tScriptClock = tScriptStart;
+	iDelayCount = 0;
+
+	std::lock_guard<std::mutex> sync(mutexResponse);
+	iTimelineCount = 0;
+	iTimelineEntry = -1;
+	bTimelineSaved = false;
+}
+
+double Autonomous::ScriptTime()
+{
+	struct timespec tNow;
+
+	clock_gettime(CLOCK_MONOTONIC, &tNow);
+	return(TimespecDiff(tNow, tScriptStart));
+}
 
-	//send messages to each component
-	for (unsigned int i = 0; i < szQueueNames.size(); i++)
+void Autonomous::TimelineStart(const AutoInstruction &rInstruction)
+{
+	std::lock_guard<std::mutex> sync(mutexResponse);
+	AutoTimelineEntry *pEntry;
+
+	if(iTimelineCount >= AUTONOMOUS_MAX_TIMELINE)
 	{
-		iPipeXmt = open(szQueueNames[i], O_WRONLY);
-		wpi_assert(iPipeXmt > 0);
+		iTimelineEntry = -1;
+		return;
+	}
+
+	iTimelineEntry = iTimelineCount++;
+	pEntry = &timeline[iTimelineEntry];
+	pEntry->iLine = rInstruction.iLine;
+	pEntry->iCommand = rInstruction.iCommand;
+	pEntry->fIssued = ScriptTime();
+	pEntry->fAcked = 0.0;
+	pEntry->fCompleted = 0.0;
+	pEntry->eReason = AUTO_COMPLETE_NONE;
+	Odometry::GetPose(pEntry->pose);
+}
+
+void Autonomous::TimelineFinish()
+{
+	std::lock_guard<std::mutex> sync(mutexResponse);
+
+	// a command sent between PARALLEL and JOIN finishes when its response comes in,
+	// everything else is done when the script thread moves on
 
-		Message.replyQ = AUTONOMOUS_QUEUE;
-		Message.command = commands[i];
-		write(iPipeXmt, (char*) &Message, sizeof(RobotMessage));
-		close(iPipeXmt);
+	bool bWaitForResponse = bParallel && pRunningInstruction && (pRunningInstruction->fTimeout > 0.0);
+
+	if((iTimelineEntry >= 0) && !bWaitForResponse && (timeline[iTimelineEntry].eReason == AUTO_COMPLETE_NONE))
+	{
+		timeline[iTimelineEntry].fCompleted = ScriptTime();
+		timeline[iTimelineEntry].eReason = AUTO_COMPLETE_DONE;
 	}
 
-	while (uResponseCount < szQueueNames.size())
+	iTimelineEntry = -1;
+}
+
+void Autonomous::SaveTimeline()
+{
+	static const char *szReasons[] = { "running", "done", "timeout", "disabled", "no response", "error", "slip", "impact" };
+	std::lock_guard<std::mutex> sync(mutexResponse);
+	FILE *pFile;
+	char szText[160];
+
+	if(bTimelineSaved)
 	{
-		while (!bReceivedCommandResponse)
-		{
-			//purposefully empty
-		}
+		return;
+	}
 
-		if(iAutoDebugMode)
-		{
-			printf("%0.3lf Response received\n", pDebugTimer->Get());
-		}
+	bTimelineSaved = true;
+	pFile = fopen(AUTONOMOUS_TIMELINE_FILEPATH, "w");
 
-		if (ReceivedCommand == COMMAND_AUTONOMOUS_RESPONSE_OK)
-		{
-			SmartDashboard::PutString("Auto Status", "auto ok");
-			bReturn = true;
-		}
-		else if (ReceivedCommand == COMMAND_AUTONOMOUS_RESPONSE_ERROR)
+	snprintf(szText, sizeof(szText), "%5s  %-10s %8s %8s %8s %8s %7s %7s %7s  %s\n",
+			"line", "command", "issued", "acked", "complete", "duration", "x", "y", "heading", "reason");
+	printf("%s", szText);
+
+	if(pFile)
+	{
+		fputs(szText, pFile);
+	}
+
+	for(int i = 0; i < iTimelineCount; i++)
+	{
+		const AutoTimelineEntry &rEntry = timeline[i];
+
+		snprintf(szText, sizeof(szText), "%5d  %-10s %8.3f %8.3f %8.3f %8.3f %7.2f %7.2f %7.1f  %s\n",
+				rEntry.iLine, autoTokens[rEntry.iCommand].szName, rEntry.fIssued, rEntry.fAcked,
+				rEntry.fCompleted, (rEntry.fCompleted > 0.0) ? rEntry.fCompleted - rEntry.fIssued : 0.0,
+				rEntry.pose.fX, rEntry.pose.fY, rEntry.pose.fHeading * 180.0 / M_PI,
+				szReasons[rEntry.eReason]);
+		printf("%s", szText);
+
+		if(pFile)
 		{
-			SmartDashboard::PutString("Auto Status", "EARLY DEATH!");
-			bReturn = false;
+			fputs(szText, pFile);
 		}
 	}
-	return bReturn;
+
+	if(pFile)
+	{
+		fclose(pFile);
+	}
+	else
+	{
+		printf("could not write %s\n", AUTONOMOUS_TIMELINE_FILEPATH);
+	}
 }
 
-bool Autonomous::CommandNoResponse(const char *szQueueName) {
-	int iPipeXmt;
+void Autonomous::Delay(float delayTime)
+{
+	struct timespec tNow;
 
-	iPipeXmt = open(szQueueName, O_WRONLY);
-	wpi_assert(iPipeXmt > 0);
+	// the deadline comes from the script clock, not from when we got here, so time
+	// lost waking up from the last DELAY is taken out of this one
 
-	write(iPipeXmt, (char*) &Message, sizeof(RobotMessage));
-	close(iPipeXmt);
-	return (true);
+	TimespecAdd(tScriptClock, delayTime);
+
+	while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &tScriptClock, NULL) == EINTR)
+	{
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &tNow);
+
+	if(iDelayCount < AUTONOMOUS_MAX_DELAYS)
+	{
+		fDelayOvershoot[iDelayCount] = TimespecDiff(tNow, tScriptClock);
+		iDelayLine[iDelayCount] = pRunningInstruction ? pRunningInstruction->iLine : 0;
+		iDelayCount++;
+	}
+
+	// if we were paused while asleep wait here until we are allowed to go on
+
+	WaitWhilePaused();
 }
 
-void Autonomous::Delay(float delayTime)
+void Autonomous::ReportDelays()
 {
-	double fWait;
+	float fWorst = 0.0;
 
-
-	for (fWait = 0.0; fWait < delayTime; fWait += 0.01)
+	for(int i = 0; i < iDelayCount; i++)
 	{
-		// if we are paused break the delay into pieces
-		while (bPauseAutoMode)
-		{
-			Wait(0.02);
-		}
+		printf("DELAY on line %d woke %0.3f ms late\n", iDelayLine[i], fDelayOvershoot[i] * 1000.0);
+		fWorst = std::max(fWorst, fDelayOvershoot[i]);
+	}
 
-		Wait(0.01);
+	if(iDelayCount > 0)
+	{
+		SmartDashboard::PutNumber("Auto Delay Overshoot ms", fWorst * 1000.0);
 	}
 }
 
-bool Autonomous::Begin(char *pCurrLinePos)
+bool Autonomous::Begin(const AutoInstruction &rInstruction)
 {
 	//tell all the components who may need to know that auto is beginning
 	Message.command = COMMAND_AUTONOMOUS_RUN;
 	return (CommandNoResponse(DRIVETRAIN_QUEUE));
 }
 
-bool Autonomous::End(char *pCurrLinePos)
+bool Autonomous::End(const AutoInstruction &rInstruction)
 {
 	//tell all the components who may need to know that auto is beginning
 	Message.command = COMMAND_AUTONOMOUS_COMPLETE;
@@ -162,18 +430,14 @@ bool Autonomous::End(char *pCurrLinePos)
 	return (true);
 }
 
-bool Autonomous::Move(char *pCurrLinePos) {
-	char *pToken;
+bool Autonomous::Move(const AutoInstruction &rInstruction) {
 	float fLeft;
 	float fRight;
 
-	// parse remainder of line to get length to move
+	// the parameters were checked when the script was compiled
 
-	pToken = strtok_r(pCurrLinePos, szDelimiters, &pCurrLinePos);
-	fLeft = atof(pToken);
-
-	pToken = strtok_r(pCurrLinePos, szDelimiters, &pCurrLinePos);
-	fRight = atof(pToken);
+	fLeft = rInstruction.fParam[0];
+	fRight = rInstruction.fParam[1];
 
 	if ((fabs(fLeft) > MAX_VELOCITY_PARAM)
 			|| (fabs(fRight) > MAX_VELOCITY_PARAM))
@@ -188,204 +452,414 @@ bool Autonomous::Move(char *pCurrLinePos) {
 	return (CommandNoResponse(DRIVETRAIN_QUEUE));
 }
 
-bool Autonomous::MeasuredMove(char *pCurrLinePos) {
-
-	char *pToken;
-	float fDistance;
-	float fSpeed;
-	float fTime;
+bool Autonomous::MeasuredMove(const AutoInstruction &rInstruction) {
 
-	// parse remainder of line to get length to move
+	// send the message to the drive train
 
-	pToken = strtok_r(pCurrLinePos, szDelimiters, &pCurrLinePos);
+	Message.command = COMMAND_DRIVETRAIN_AUTO_MMOVE;
+	Message.params.mmove.fSpeed = rInstruction.fParam[0];
+	Message.params.mmove.fDistance = rInstruction.fParam[1];
+	Message.params.mmove.fTime = rInstruction.fParam[2];
+	Message.params.mmove.fExitSpeed = rInstruction.fExitSpeed;
+	Message.params.mmove.bBlend = rInstruction.bBlend;
 
-	if(pToken == NULL)
-	{
-		SmartDashboard::PutString("Auto Status","EARLY DEATH!");
-		return (false);
-	}
+	return (CommandResponse(DRIVETRAIN_QUEUE));
+}
 
-	fSpeed = atof(pToken);
+bool Autonomous::MeasuredMoveProximity(const AutoInstruction &rInstruction) {
 
-	pToken = strtok_r(pCurrLinePos, szDelimiters, &pCurrLinePos);
+	// send the message to the drive train
 
-	if(pToken == NULL)
-	{
-		SmartDashboard::PutString("Auto Status","EARLY DEATH!");
-		return (false);
-	}
+	Message.command = COMMAND_DRIVETRAIN_AUTO_PMOVE;
+	Message.params.pmove.fSpeed = rInstruction.fParam[0];
+	Message.params.pmove.fDistance = rInstruction.fParam[1];
+	Message.params.pmove.fTime = rInstruction.fParam[2];
+	Message.params.pmove.fExitSpeed = rInstruction.fExitSpeed;
+	Message.params.pmove.bBlend = rInstruction.bBlend;
 
-	fDistance = atof(pToken);
+	return (CommandResponse(DRIVETRAIN_QUEUE));
+}
 
-	pToken = strtok_r(pCurrLinePos, szDelimiters, &pCurrLinePos);
+bool Autonomous::TimedMove(const AutoInstruction &rInstruction) {
 
-	if(pToken == NULL)
-	{
-		SmartDashboard::PutString("Auto Status","EARLY DEATH!");
-		return (false);
-	}
+	// send the message to the drive train
+	Message.command = COMMAND_DRIVETRAIN_AUTO_TMOVE;
+	Message.params.tmove.fSpeed = rInstruction.fParam[0];
+	Message.params.tmove.fTime = rInstruction.fParam[1];
+	return (CommandNoResponse(DRIVETRAIN_QUEUE));
+}
 
-	fTime = atof(pToken);
+bool Autonomous::Turn(const AutoInstruction &rInstruction) {
 
 	// send the message to the drive train
+	Message.command = COMMAND_DRIVETRAIN_TURN;
+	Message.params.turn.fAngle = rInstruction.fParam[0];
+	Message.params.turn.fTimeout = rInstruction.fParam[1];
+	Message.params.turn.bBlend = rInstruction.bBlend;
+	return (CommandResponse(DRIVETRAIN_QUEUE));
+}
 
-	Message.command = COMMAND_DRIVETRAIN_AUTO_MMOVE;
-	Message.params.mmove.fSpeed = fSpeed;
-	Message.params.mmove.fDistance = fDistance;
-	Message.params.mmove.fTime = fTime;
+bool Autonomous::Arc(const AutoInstruction &rInstruction) {
 
+	// send the message to the drive train
+	Message.command = COMMAND_DRIVETRAIN_AUTO_ARC;
+	Message.params.arc.fSpeed = rInstruction.fParam[0];
+	Message.params.arc.fRadius = rInstruction.fParam[1];
+	Message.params.arc.fAngle = rInstruction.fParam[2];
+	Message.params.arc.fTime = rInstruction.fParam[3];
+	Message.params.arc.fExitSpeed = rInstruction.fExitSpeed;
+	Message.params.arc.bBlend = rInstruction.bBlend;
 	return (CommandResponse(DRIVETRAIN_QUEUE));
 }
 
-bool Autonomous::MeasuredMoveProximity(char *pCurrLinePos) {
+bool Autonomous::GearRelease()
+{
+	// move measure distance forward/backward
 
-	char *pToken;
-	float fDistance;
-	float fSpeed;
-	float fTime;
+	Message.command = COMMAND_GEARINTAKE_RELEASE;
+	CommandNoResponse(GEARINTAKE_QUEUE);
+	return (true);
+}
 
-	// parse remainder of line to get length to move
+bool Autonomous::GearHold()
+{
+	// move measure distance forward/backward
+
+	Message.command = COMMAND_GEARINTAKE_HOLD;
+	CommandNoResponse(GEARINTAKE_QUEUE);
+	return (true);
+}
+
+bool Autonomous::GearHangMacro()
+{
+	// run the gear hangar macro, should only take 750ms or so
+
+	Message.command = COMMAND_MACRO_HANGGEAR;
+	CommandNoResponse(GEARFLOORINTAKE_QUEUE);
+	CommandNoResponse(DRIVETRAIN_QUEUE);
+	Delay(1.0);
+	return (true);
+}
+
+bool Autonomous::Climber()
+{
+	Message.command = COMMAND_AUTO_CLIMBER;
+	Message.params.climber.ClimbUp=1.0;
+	return (CommandNoResponse(CLIMBER_QUEUE));
+}
 
-	pToken = strtok_r(pCurrLinePos, szDelimiters, &pCurrLinePos);
+bool Autonomous::WaitUntil(const AutoInstruction &rInstruction)
+{
+	// the component that owns the sensor wakes us when it publishes a reading
+	// that makes the condition true
 
-	if(pToken == NULL)
+	if(AutoSensors::GetInstance()->WaitUntil(rInstruction.condition, rInstruction.fTimeout))
 	{
-		SmartDashboard::PutString("Auto Status","EARLY DEATH!");
-		return (false);
+		return(true);
 	}
 
-	fSpeed = atof(pToken);
+	printf("%0.3lf %s timed out\n", pDebugTimer->Get(), rInstruction.sText.c_str());
 
-	pToken = strtok_r(pCurrLinePos, szDelimiters, &pCurrLinePos);
+	std::lock_guard<std::mutex> sync(mutexResponse);
 
-	if(pToken == NULL)
+	if(iTimelineEntry >= 0)
 	{
-		SmartDashboard::PutString("Auto Status","EARLY DEATH!");
-		return (false);
+		timeline[iTimelineEntry].fCompleted = ScriptTime();
+		timeline[iTimelineEntry].eReason = AUTO_COMPLETE_TIMEOUT;
 	}
 
-	fDistance = atof(pToken);
+	return(false);
+}
 
-	pToken = strtok_r(pCurrLinePos, szDelimiters, &pCurrLinePos);
+bool Autonomous::PreloadFiles()
+{
+	std::shared_ptr<const AutoProgram> pCheckProgram;
+	const AutoRoutine *pCheckRoutine = GetRoutine(pCheckProgram);
+	std::unique_lock<std::mutex> lock(mutexFiles, std::try_to_lock);
+	int iPath = 0;
 
-	if(pToken == NULL)
+	// read the recording and map the paths now so autonomous does not spend
+	// time on files, Load and Open do nothing if they already have this file.
+	// False if the files are busy and we have to try again
+
+	if(!lock.owns_lock())
 	{
-		SmartDashboard::PutString("Auto Status","EARLY DEATH!");
-		return (false);
+		return(false);
 	}
 
-	fTime = atof(pToken);
+	if(!pCheckRoutine)
+	{
+		return(true);
+	}
 
-	// send the message to the drive train
+	for(unsigned int i = 0; i < pCheckRoutine->instructions.size(); i++)
+	{
+		const AutoInstruction &rInstruction = pCheckRoutine->instructions[i];
+		string sPath = string(AUTONOMOUS_SCRIPT_DIRECTORY) + "/" + rInstruction.sParam[0];
 
-	Message.command = COMMAND_DRIVETRAIN_AUTO_PMOVE;
-	Message.params.pmove.fSpeed = fSpeed;
-	Message.params.pmove.fDistance = fDistance;
-	Message.params.pmove.fTime= fTime;
+		if(rInstruction.iCommand == AUTO_TOKEN_REPLAY)
+		{
+			pPlayer->Load(sPath.c_str());
+		}
+		else if((rInstruction.iCommand == AUTO_TOKEN_PATH) && (iPath < AUTONOMOUS_MAX_PATHS))
+		{
+			pPaths[iPath++].Open(sPath.c_str());
+		}
+	}
 
-	return (CommandResponse(DRIVETRAIN_QUEUE));
+	return(true);
 }
 
-bool Autonomous::TimedMove(char *pCurrLinePos) {
-	char *pToken;
-	float fSpeed;
-	float fTime;
-
-	// parse remainder of line to get length to move
+bool Autonomous::Replay(const AutoInstruction &rInstruction)
+{
+	static const char *const szTargets[] = { DRIVETRAIN_QUEUE, GEARFLOORINTAKE_QUEUE, CLIMBER_QUEUE };
+	std::lock_guard<std::mutex> sync(mutexFiles);
+	string sPath = string(AUTONOMOUS_SCRIPT_DIRECTORY) + "/" + rInstruction.sParam[0];
+	int iPipes[RECORD_LAST];
+	struct timespec tStart;
+	struct timespec tDeadline;
+	struct timespec tNow;
+	double fLate;
+	double fWorstLate = 0.0;
+	double fTotalLate = 0.0;
+	int iSent = 0;
+	RobotMessage replayMessage;
+
+	static_assert(sizeof(szTargets)/sizeof(szTargets[0]) == RECORD_LAST, "szTargets does not match RecordTarget");
+
+	if(!pPlayer->Load(sPath.c_str()))
+	{
+		printf("%0.3lf can not replay %s\n", pDebugTimer->Get(), sPath.c_str());
+		return(false);
+	}
 
-	pToken = strtok_r(pCurrLinePos, szDelimiters, &pCurrLinePos);
+	// keep the queues open for the whole replay, opening one costs more than
+	// the timing we are trying to hold
 
-	if(pToken == NULL)
+	for(int i = 0; i < RECORD_LAST; i++)
 	{
-		SmartDashboard::PutString("Auto Status","DEATH BY PARAMS!");
-		PRINTAUTOERROR;
-		return (false);
+		iPipes[i] = open(szTargets[i], O_WRONLY);
+		wpi_assert(iPipes[i] > 0);
 	}
 
-	fSpeed = atof(pToken);
-	pToken = strtok_r(pCurrLinePos, szDelimiters, &pCurrLinePos);
+	replayMessage.replyQ = AUTONOMOUS_QUEUE;
+	replayMessage.uReplyId = 0;
+	clock_gettime(CLOCK_MONOTONIC, &tStart);
 
-	if(pToken == NULL)
+	for(int i = 0; i < pPlayer->GetCount(); i++)
 	{
-		SmartDashboard::PutString("Auto Status","DEATH BY PARAMS!");
-		PRINTAUTOERROR;
-		return (false);
+		const RecordedCommand &rRecord = pPlayer->GetRecord(i);
+
+		tDeadline = tStart;
+		TimespecAdd(tDeadline, rRecord.uMicroseconds / 1.0e6);
+
+		while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &tDeadline, NULL) == EINTR)
+		{
+		}
+
+		// autonomous is over, the driver has the robot now
+
+		if(bPauseAutoMode)
+		{
+			break;
+		}
+
+		replayMessage.command = (MessageCommand)rRecord.uCommand;
+		replayMessage.params = rRecord.params;
+		write(iPipes[rRecord.uTarget], (char*) &replayMessage, sizeof(RobotMessage));
+
+		clock_gettime(CLOCK_MONOTONIC, &tNow);
+		fLate = TimespecDiff(tNow, tDeadline);
+		fWorstLate = std::max(fWorstLate, fLate);
+		fTotalLate += fLate;
+		iSent++;
 	}
 
-	fTime = atof(pToken);
+	// leave everything stopped, the recording ends wherever the driver let go
 
-	// send the message to the drive train
-	Message.command = COMMAND_DRIVETRAIN_AUTO_TMOVE;
-	Message.params.tmove.fSpeed = fSpeed;
-	Message.params.tmove.fTime = fTime;
-	return (CommandNoResponse(DRIVETRAIN_QUEUE));
+	replayMessage.command = COMMAND_DRIVETRAIN_STOP;
+	write(iPipes[RECORD_DRIVETRAIN], (char*) &replayMessage, sizeof(RobotMessage));
+	replayMessage.command = COMMAND_GEARFLOORINTAKE_STOP;
+	write(iPipes[RECORD_GEARFLOOR], (char*) &replayMessage, sizeof(RobotMessage));
+	replayMessage.command = COMMAND_CLIMBER_STOP;
+	write(iPipes[RECORD_CLIMBER], (char*) &replayMessage, sizeof(RobotMessage));
+
+	for(int i = 0; i < RECORD_LAST; i++)
+	{
+		close(iPipes[i]);
+	}
+
+	printf("%0.3lf replayed %d of %d commands, %0.1lf us late on average, %0.1lf us worst\n",
+			pDebugTimer->Get(), iSent, pPlayer->GetCount(),
+			iSent ? fTotalLate / iSent * 1.0e6 : 0.0, fWorstLate * 1.0e6);
+	SmartDashboard::PutNumber("Replay Worst Late us", fWorstLate * 1.0e6);
+	return(iSent == pPlayer->GetCount());
 }
 
-bool Autonomous::Turn(char *pCurrLinePos) {
-	char *pToken;
-	float fAngle;
-	float fTimeout;
-	// parse remainder of line to get target angle and timeout
-	pToken = strtok_r(pCurrLinePos, szDelimiters, &pCurrLinePos);
+PathFile *Autonomous::FindPath(const string &rPath)
+{
+	PathFile *pSpare = &pPaths[AUTONOMOUS_MAX_PATHS - 1];
 
-	if(pToken == NULL)
+	for(int i = 0; i < AUTONOMOUS_MAX_PATHS; i++)
 	{
-		SmartDashboard::PutString("Auto Status","DEATH BY PARAMS!");
-		return (false);
+		if(pPaths[i].IsOpen() && (rPath == pPaths[i].GetName()))
+		{
+			return(&pPaths[i]);
+		}
 	}
 
-	fAngle = atof(pToken);
+	// the routine changed since we were disabled, better late than never
 
-	pToken = strtok_r(pCurrLinePos, szDelimiters, &pCurrLinePos);
+	printf("%0.3lf %s was not mapped before autonomous\n", pDebugTimer->Get(), rPath.c_str());
+	return(pSpare->Open(rPath.c_str()) ? pSpare : NULL);
+}
 
-	if(pToken == NULL)
+bool Autonomous::Path(const AutoInstruction &rInstruction)
+{
+	std::lock_guard<std::mutex> sync(mutexFiles);
+	PathFile *pPath = FindPath(string(AUTONOMOUS_SCRIPT_DIRECTORY) + "/" + rInstruction.sParam[0]);
+	struct timespec tStart;
+	struct timespec tDeadline;
+	struct timespec tNow;
+	double fLate;
+	double fWorstLate = 0.0;
+	AutoCompletion eStopped = AUTO_COMPLETE_NONE;
+	RobotMessage pathMessage;
+	int iPipe;
+	int iLast;
+
+	if(!pPath)
 	{
-		SmartDashboard::PutString("Auto Status","DEATH BY PARAMS!");
-		return (false);
+		printf("%0.3lf can not follow %s\n", pDebugTimer->Get(), rInstruction.sParam[0].c_str());
+		return(false);
 	}
 
-	fTimeout = atof(pToken);
+	// stream every sample but the last to the drivetrain on the control period,
+	// the queue stays open so each one is just a write
+
+	iLast = pPath->GetCount() - 1;
+	iPipe = open(DRIVETRAIN_QUEUE, O_WRONLY);
+	wpi_assert(iPipe > 0);
+
+	pathMessage.command = COMMAND_DRIVETRAIN_AUTO_PATH;
+	pathMessage.replyQ = AUTONOMOUS_QUEUE;
+	pathMessage.uReplyId = 0;
+	clock_gettime(CLOCK_MONOTONIC, &tStart);
+
+	for(int i = 0; i <= iLast; i++)
+	{
+		const PathSample &rSample = pPath->GetSample(i);
+
+		tDeadline = tStart;
+		TimespecAdd(tDeadline, i * pPath->GetPeriod());
+
+		while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &tDeadline, NULL) == EINTR)
+		{
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &tNow);
+		fLate = TimespecDiff(tNow, tDeadline);
+		fWorstLate = std::max(fWorstLate, fLate);
+
+		if(bPauseAutoMode)
+		{
+			eStopped = AUTO_COMPLETE_DISABLED;
+			break;
+		}
+		else if(TimespecDiff(tNow, tStart) > rInstruction.fTimeout)
+		{
+			eStopped = AUTO_COMPLETE_TIMEOUT;
+			break;
+		}
+
+		pathMessage.params.path.fX = rSample.fX;
+		pathMessage.params.path.fY = rSample.fY;
+		pathMessage.params.path.fHeading = rSample.fHeading;
+		pathMessage.params.path.fVelocity = rSample.fVelocity;
+		pathMessage.params.path.fCurvature = rSample.fCurvature;
+		pathMessage.params.path.bFirst = (i == 0);
+		pathMessage.params.path.bLast = (i == iLast);
+
+		if(i < iLast)
+		{
+			write(iPipe, (char*) &pathMessage, sizeof(RobotMessage));
+		}
+	}
+
+	close(iPipe);
+	printf("%0.3lf %s %0.1lf us worst late\n", pDebugTimer->Get(), rInstruction.sParam[0].c_str(),
+			fWorstLate * 1.0e6);
+
+	if(eStopped != AUTO_COMPLETE_NONE)
+	{
+		printf("%0.3lf %s stopped early\n", pDebugTimer->Get(), rInstruction.sText.c_str());
+		Message.command = COMMAND_DRIVETRAIN_STOP;
+		CommandNoResponse(DRIVETRAIN_QUEUE);
+
+		std::lock_guard<std::mutex> syncResponse(mutexResponse);
+
+		if(iTimelineEntry >= 0)
+		{
+			timeline[iTimelineEntry].fCompleted = ScriptTime();
+			timeline[iTimelineEntry].eReason = eStopped;
+		}
+
+		return(false);
+	}
+
+	// the last sample goes like any other command, the drivetrain answers when
+	// it has stopped at the end of the path
+
+	Message.command = COMMAND_DRIVETRAIN_AUTO_PATH;
+	Message.params.path = pathMessage.params.path;
+	fBranchTimeout = std::max(rInstruction.fTimeout - (float)TimespecDiff(tNow, tStart), 0.1f);
 
-	// send the message to the drive train
-	Message.command = COMMAND_DRIVETRAIN_TURN;
-	Message.params.turn.fAngle= fAngle;
-	Message.params.turn.fTimeout = fTimeout;
 	return (CommandResponse(DRIVETRAIN_QUEUE));
 }
 
-bool Autonomous::GearRelease()
+bool Autonomous::Arm(const AutoInstruction &rInstruction)
 {
-	// move measure distance forward/backward
+	// the compiler already made sure this is one of the three
 
-	Message.command = COMMAND_GEARINTAKE_RELEASE;
-	CommandNoResponse(GEARINTAKE_QUEUE);
-	return (true);
-}
+	if(rInstruction.sParam[0] == "FLOOR")
+	{
+		Message.command = COMMAND_GEARFLOORINTAKE_INTAKEPOS;
+	}
+	else if(rInstruction.sParam[0] == "DRIVE")
+	{
+		Message.command = COMMAND_GEARFLOORINTAKE_DRIVEPOS;
+	}
+	else
+	{
+		Message.command = COMMAND_GEARFLOORINTAKE_RELEASEPOS;
+	}
 
-bool Autonomous::GearHold()
-{
-	// move measure distance forward/backward
+	// the arm answers when it gets there, so a JOIN can wait for it
 
-	Message.command = COMMAND_GEARINTAKE_HOLD;
-	CommandNoResponse(GEARINTAKE_QUEUE);
-	return (true);
+	Message.params.floor.fTimeout = rInstruction.fParam[1];
+	return (CommandResponse(GEARFLOORINTAKE_QUEUE));
 }
 
-bool Autonomous::GearHangMacro()
+bool Autonomous::Intake(const AutoInstruction &rInstruction)
 {
-	// run the gear hangar macro, should only take 750ms or so
+	float fSpeed = rInstruction.fParam[0];
 
-	Message.command = COMMAND_MACRO_HANGGEAR;
-	CommandNoResponse(GEARFLOORINTAKE_QUEUE);
-	CommandNoResponse(DRIVETRAIN_QUEUE);
-	Wait(1.0);
-	return (true);
-}
+	if(fSpeed > 0.0)
+	{
+		Message.command = COMMAND_GEARFLOORINTAKE_PULLIN;
+		Message.params.floor.fSpeed = fSpeed;
+	}
+	else if(fSpeed < 0.0)
+	{
+		Message.command = COMMAND_GEARFLOORINTAKE_PUSHOUT;
+		Message.params.floor.fSpeed = -fSpeed;
+	}
+	else
+	{
+		Message.command = COMMAND_GEARFLOORINTAKE_STOP;
+		Message.params.floor.fSpeed = 0.0;
+	}
 
-bool Autonomous::Climber()
-{
-	Message.command = COMMAND_AUTO_CLIMBER;
-	Message.params.climber.ClimbUp=1.0;
-	return (CommandNoResponse(CLIMBER_QUEUE));
+	return (CommandNoResponse(GEARFLOORINTAKE_QUEUE));
 }
 
@@ -8,20 +8,67 @@
 //Robot
 #include <ComponentBase.h> //For the ComponentBase class
 #include <RobotParams.h> //For various robot parameters
+#include <AutoProgram.h> //For the compiled script
+#include <AutoSensors.h> //For WAIT_UNTIL and IF
+#include <DriveRecorder.h> //For REPLAY
+#include <PathFile.h> //For PATH
+#include <Odometry.h> //For the pose in the timeline
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <set>
 #include <string>
 #include <thread>
+#include <time.h>
 
 #include "WPILib.h"
 
 
-// if you have more than this many lines in your script, THEY WILL NOT RUN! Change if needed.
-const int AUTONOMOUS_SCRIPT_LINES = 150;
 const int AUTONOMOUS_CHECKLIST_LINES = 150;
+const char* const AUTONOMOUS_SCRIPT_DIRECTORY = "/home/lvuser";
+const char* const AUTONOMOUS_SCRIPT_FILENAME = "RhsScript.txt";
 const char* const AUTONOMOUS_SCRIPT_FILEPATH = "/home/lvuser/RhsScript.txt";
 
-//from 2014
-const float MAX_VELOCITY_PARAM = 1.0;
-const float MAX_DISTANCE_PARAM = 100.0;
+// only used if inotify is not available, how often to stat the script file
+const float AUTONOMOUS_SCRIPT_POLL_PERIOD = 1.0;
+
+// how many commands can be outstanding between PARALLEL and JOIN
+const int AUTONOMOUS_MAX_BRANCHES = 8;
+// extra time we give a component past its own timeout before we stop waiting on it
+const float AUTONOMOUS_BRANCH_GRACE = 0.25;
+// how many different PATH files a routine can use, each is mapped while we are disabled
+const int AUTONOMOUS_MAX_PATHS = 8;
+// how many DELAY overshoots we keep for the report at the end of a run
+const int AUTONOMOUS_MAX_DELAYS = 32;
+// how many script lines we keep timing for, extra lines in a run are not recorded
+const int AUTONOMOUS_MAX_TIMELINE = 256;
+// where the timing table goes after each run
+const char* const AUTONOMOUS_TIMELINE_FILEPATH = "/home/lvuser/AutoTimeline.txt";
+
+///A command sent to a component that we may be waiting on
+struct AutoBranch {
+	unsigned uReplyId;
+	const char *szQueueName;
+	bool bResponse;				//false if the component will not report back
+	bool bComplete;
+	bool bTimedOut;
+	MessageCommand result;
+	std::chrono::steady_clock::time_point deadline;
+	int iTimelineEntry;			//where to record the response, -1 if not recorded
+};
+
+///When one script line ran, in seconds from the start of autonomous
+struct AutoTimelineEntry {
+	int iLine;
+	int iCommand;
+	float fIssued;				//the script thread started the line
+	float fAcked;				//the component read the command, 0 if unknown
+	float fCompleted;			//finished, 0 if it never did
+	AutoCompletion eReason;
+	RobotPose pose;				//where the robot was when the line started
+};
 
 class Autonomous : public ComponentBase
 {
@@ -43,43 +90,98 @@ public:
 	}
 
 protected:
-	bool Evaluate(std::string statement);	//Evaluates an autonomous script statement
+	bool Evaluate(const AutoInstruction &rInstruction);	//Evaluates an autonomous script statement
 	RobotMessage Message;
-	bool bScriptLoaded; //not yet in use
-	bool bInAutoMode;
-	bool bPauseAutoMode;
+	bool bScriptLoaded;
+	std::atomic<bool> bInAutoMode;		//read anywhere, written under mutexState so waiters see the change
+	std::atomic<bool> bPauseAutoMode;	//the same
 
 private:
-	std::string script[AUTONOMOUS_SCRIPT_LINES];	//Autonomous script
+	std::shared_ptr<const AutoProgram> pProgram;	//the compiled script, swapped when the file changes
+	const AutoRoutine *pSelectedRoutine;			//points into pProgram, the MODE block to run
+	mutable priority_recursive_mutex mutexProgram;
+	SendableChooser<int> *pModeChooser;
+	std::set<int> modesOffered;					//modes already added to the chooser
+	int iScriptNotify;			//inotify descriptor watching the script directory
+	bool bScriptChanged;
+	bool bFilesChanged;			//the routine or a file beside the script changed, preload again
+	time_t tScriptModified;		//used if we have to poll the file instead
+	off_t iScriptSize;
+	Timer *pScriptPollTimer;
 	int lineNumber;
+	int iJumpTo;								//set by IF and ELSE, the next instruction if not lineNumber + 1
+	const AutoInstruction *pRunningInstruction;	//what the script thread is doing, NULL between runs
 	int iAutoDebugMode;
 	std::thread *pScript;
-	bool bReceivedCommandResponse;
-	unsigned int uResponseCount;
-	MessageCommand ReceivedCommand;
+	std::mutex mutexState;					//held to change bInAutoMode or bPauseAutoMode and wait on them
+	std::condition_variable stateChanged;	//signaled on every state change, the script thread waits on it
+	double fEnableTime;						//FPGA time autonomous was enabled
+	double fWakeTime;						//FPGA time the script thread woke up
+	bool bFirstCommandSent;					//have we measured the start latency this run?
+	struct timespec tScriptStart;			//CLOCK_MONOTONIC time autonomous was enabled
+	struct timespec tScriptClock;			//where the script is on the timeline, DELAYs count from here
+	float fDelayOvershoot[AUTONOMOUS_MAX_DELAYS];	//how late each DELAY woke up, seconds
+	int iDelayLine[AUTONOMOUS_MAX_DELAYS];
+	int iDelayCount;
+	AutoTimelineEntry timeline[AUTONOMOUS_MAX_TIMELINE];	//protected by mutexResponse
+	int iTimelineCount;
+	int iTimelineEntry;						//entry for the line being run, -1 if none
+	bool bTimelineSaved;
+	std::mutex mutexResponse;				//protects the branches, responses arrive on the message thread
+	std::condition_variable responseReady;
+	AutoBranch branches[AUTONOMOUS_MAX_BRANCHES];
+	int iBranchCount;
+	unsigned uLastReplyId;
+	bool bParallel;							//between PARALLEL and JOIN
+	float fBranchTimeout;					//timeout of the command being sent
 	Timer *pDebugTimer;
+	DriveRecorder *pPlayer;					//the recording REPLAY plays back
+	PathFile *pPaths;						//AUTONOMOUS_MAX_PATHS of them, for PATH
+	std::mutex mutexFiles;					//protects pPlayer and pPaths
 
-	bool Begin(char *);
-	bool End(char *);
+	bool Begin(const AutoInstruction &);
+	bool End(const AutoInstruction &);
 	void Delay(float);
-	bool Move(char *);
-	bool MeasuredMove(char *);
-	bool MeasuredMoveProximity(char *);
-	bool TimedMove(char *);
-	bool Turn(char *);
+	bool Move(const AutoInstruction &);
+	bool MeasuredMove(const AutoInstruction &);
+	bool MeasuredMoveProximity(const AutoInstruction &);
+	bool TimedMove(const AutoInstruction &);
+	bool Turn(const AutoInstruction &);
+	bool Arc(const AutoInstruction &);
 	bool GearRelease(void);
 	bool GearHold(void);
 	bool GearHangMacro(void);
 	bool Climber(void);
+	bool Arm(const AutoInstruction &);
+	bool Intake(const AutoInstruction &);
+	bool WaitUntil(const AutoInstruction &);
+	bool Replay(const AutoInstruction &);
+	bool Path(const AutoInstruction &);
+	PathFile *FindPath(const std::string &rPath);
+	bool PreloadFiles();
 
+	void SendCommand(const char *szQueueName, bool bResponse);
+	void CommandComplete(const RobotMessage &rResponse);
+	bool WaitForCommands(bool bAll, float fTimeout);
 	bool CommandResponse(const char *szQueueName);
 	bool CommandNoResponse(const char *szQueueName);
-	bool MultiCommandResponse(vector<char*> szQueueNames, vector<MessageCommand> commands);
 
 	void Init();
 	void OnStateChange();
+	void WaitWhilePaused();
+	void StartScriptClock();
+	void ReportDelays();
+	double ScriptTime();
+	void TimelineStart(const AutoInstruction &rInstruction);
+	void TimelineFinish();
+	void SaveTimeline();
 	void Run();
+	void CheckScriptFile();
+	bool ScriptFileChanged();
 	bool LoadScriptFile();
+	void OfferRoutines();
+	void SelectRoutine();
+	const AutoRoutine *GetRoutine(std::shared_ptr<const AutoProgram> &rProgram) const;
 };
 
 #endif //AUTONOMOUS_BASE_H
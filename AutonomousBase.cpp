@@ -3,12 +3,16 @@
  */
 
 #include <Autonomous.h>
+#include <AutoParser.h>
 #include <ComponentBase.h>
 #include <RobotParams.h>
 #include "WPILib.h"
 //Local
+#include <sys/inotify.h>
+#include <string.h>
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <string>
 
 
@@ -18,18 +22,64 @@ Autonomous::Autonomous()
 : ComponentBase(AUTONOMOUS_TASKNAME, AUTONOMOUS_QUEUE, AUTONOMOUS_PRIORITY)
 {
 	lineNumber = 0;
+	iJumpTo = -1;
 	bInAutoMode = false;
 	iAutoDebugMode = 0;
-	uResponseCount = 0;
-	bReceivedCommandResponse = false;
-	ReceivedCommand = COMMAND_UNKNOWN;
+	iBranchCount = 0;
+	uLastReplyId = 0;
+	bParallel = false;
+	fBranchTimeout = 0.0;
 
 	bPauseAutoMode = false;
 	bScriptLoaded = false;
+	bFirstCommandSent = true;
+	fEnableTime = 0.0;
+	fWakeTime = 0.0;
+	pRunningInstruction = NULL;
+	iDelayCount = 0;
+	iTimelineCount = 0;
+	iTimelineEntry = -1;
+	bTimelineSaved = true;
 
 	pDebugTimer = new Timer();
 	pDebugTimer->Start();
 
+	pPlayer = new DriveRecorder();
+	pPaths = new PathFile[AUTONOMOUS_MAX_PATHS];
+
+	// watch the directory, not the file, so we see new copies that replace it
+
+	tScriptModified = 0;
+	iScriptSize = -1;
+	bScriptChanged = true;
+	bFilesChanged = true;
+	pSelectedRoutine = NULL;
+
+	// routines are added to the chooser as we find them in the script
+
+	pModeChooser = new SendableChooser<int>();
+	SmartDashboard::PutData("Auto Mode", pModeChooser);
+
+	pScriptPollTimer = new Timer();
+	pScriptPollTimer->Start();
+
+	iScriptNotify = inotify_init1(IN_NONBLOCK);
+
+	if(iScriptNotify >= 0)
+	{
+		if(inotify_add_watch(iScriptNotify, AUTONOMOUS_SCRIPT_DIRECTORY,
+				IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE) < 0)
+		{
+			close(iScriptNotify);
+			iScriptNotify = -1;
+		}
+	}
+
+	if(iScriptNotify < 0)
+	{
+		printf("No inotify, polling %s\n", AUTONOMOUS_SCRIPT_FILEPATH);
+	}
+
 	pTask = new std::thread(&Autonomous::StartTask, this);
 	wpi_assert(pTask);
 
@@ -41,6 +91,15 @@ Autonomous::~Autonomous()	//Destructor
 {
 	delete(pTask);
 	delete(pScript);
+	delete(pScriptPollTimer);
+	delete(pModeChooser);
+	delete(pPlayer);
+	delete[] pPaths;
+
+	if(iScriptNotify >= 0)
+	{
+		close(iScriptNotify);
+	}
 }
 
 void Autonomous::Init()	//Initializes the autonomous component
@@ -54,22 +113,58 @@ void Autonomous::OnStateChange()	//Handles state changes
 
 	if(localMessage.command == COMMAND_ROBOT_STATE_AUTONOMOUS)
 	{
+		// last chance to pick up a change in the chooser, no file I/O here
+
+		SelectRoutine();
+		pDebugTimer->Reset();
+
+		// wake the script thread right now, it is waiting on stateChanged
+
+		std::lock_guard<std::mutex> sync(mutexState);
+		fEnableTime = localMessage.params.state.fTimestamp;
+		bFirstCommandSent = false;
 		bPauseAutoMode = false;
 		bInAutoMode = true;
-		pDebugTimer->Reset();
-	}
-	else if(localMessage.command == COMMAND_ROBOT_STATE_TELEOPERATED)
-	{
-		bPauseAutoMode = true;
+		stateChanged.notify_all();
 	}
-	else if(localMessage.command == COMMAND_ROBOT_STATE_DISABLED)
+	else if((localMessage.command == COMMAND_ROBOT_STATE_TELEOPERATED) ||
+			(localMessage.command == COMMAND_ROBOT_STATE_DISABLED))
 	{
-		bPauseAutoMode = true;
+		{
+			std::lock_guard<std::mutex> sync(mutexState);
+			bPauseAutoMode = true;
+			stateChanged.notify_all();
+		}
+
+		// autonomous is over, we have time to write out how it went
+
+		SaveTimeline();
 	}
 }
 
+void Autonomous::WaitWhilePaused()
+{
+	std::unique_lock<std::mutex> lock(mutexState);
+
+	stateChanged.wait(lock, [this] { return !bPauseAutoMode; });
+}
+
 void Autonomous::Run()
 {
+	// new scripts are only picked up while we are not running one, and the
+	// files are only looked at again when something changed
+
+	if(!bInAutoMode)
+	{
+		CheckScriptFile();
+		SelectRoutine();
+
+		if(bFilesChanged)
+		{
+			bFilesChanged = !PreloadFiles();
+		}
+	}
+
 	switch(localMessage.command)
 	{
 		case COMMAND_AUTONOMOUS_RUN:
@@ -79,15 +174,9 @@ void Autonomous::Run()
 			break;
 
 		case COMMAND_AUTONOMOUS_RESPONSE_OK:
-			uResponseCount++;
-			bReceivedCommandResponse = true;
-			ReceivedCommand = COMMAND_AUTONOMOUS_RESPONSE_OK;
-			break;
-
 		case COMMAND_AUTONOMOUS_RESPONSE_ERROR:
-			uResponseCount++;
-			bReceivedCommandResponse = true;
-			ReceivedCommand = COMMAND_AUTONOMOUS_RESPONSE_ERROR;
+			// wakes the script thread if it is waiting on this command
+			CommandComplete(localMessage);
 			break;
 
 		default:
@@ -95,65 +184,248 @@ void Autonomous::Run()
 	}
 }
 
+void Autonomous::CheckScriptFile()
+{
+	if(ScriptFileChanged())
+	{
+		LoadScriptFile();
+	}
+}
+
+bool Autonomous::ScriptFileChanged()
+{
+	bool bReturn = bScriptChanged;
+	char eventBuffer[1024] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+	ssize_t iLength;
+
+	bScriptChanged = false;
+
+	if(iScriptNotify >= 0)
+	{
+		// drain the events, we only care if one of them is about our file
+
+		while((iLength = read(iScriptNotify, eventBuffer, sizeof(eventBuffer))) > 0)
+		{
+			for(char *pEvent = eventBuffer; pEvent < eventBuffer + iLength;
+					pEvent += sizeof(struct inotify_event) + ((struct inotify_event *)pEvent)->len)
+			{
+				struct inotify_event *pNotify = (struct inotify_event *)pEvent;
+
+				if((pNotify->mask & IN_Q_OVERFLOW) ||
+						((pNotify->len > 0) && !strcmp(pNotify->name, AUTONOMOUS_SCRIPT_FILENAME)))
+				{
+					bReturn = true;
+				}
+				else
+				{
+					// maybe a recording or a path the routine uses
+
+					bFilesChanged = true;
+				}
+			}
+		}
+	}
+	else if(pScriptPollTimer->Get() > AUTONOMOUS_SCRIPT_POLL_PERIOD)
+	{
+		struct stat scriptStat;
+
+		pScriptPollTimer->Reset();
+
+		if(stat(AUTONOMOUS_SCRIPT_FILEPATH, &scriptStat) == 0)
+		{
+			if((scriptStat.st_mtime != tScriptModified) || (scriptStat.st_size != iScriptSize))
+			{
+				tScriptModified = scriptStat.st_mtime;
+				iScriptSize = scriptStat.st_size;
+				bReturn = true;
+			}
+		}
+		else if(iScriptSize >= 0)
+		{
+			iScriptSize = -1;
+			bReturn = true;
+		}
+	}
+
+	return(bReturn);
+}
+
 bool Autonomous::LoadScriptFile()
 {
-	bool bReturn = true;
-	//printf("Auto Script Filepath: [%s]\n", AUTONOMOUS_SCRIPT_FILEPATH);
 	ifstream scriptStream;
+	stringstream scriptText;
+	std::shared_ptr<AutoProgram> pNewProgram;
+
 	scriptStream.open(AUTONOMOUS_SCRIPT_FILEPATH);
-	
-	if(scriptStream.is_open())//not working
+
+	if(!scriptStream.is_open())
+	{
+		printf("No auto file found\n");
+
+		std::lock_guard<priority_recursive_mutex> sync(mutexProgram);
+		pProgram.reset();
+		pSelectedRoutine = NULL;
+		bScriptLoaded = false;
+		SmartDashboard::PutBoolean("Script File Loaded", false);
+		return(false);
+	}
+
+	scriptText << scriptStream.rdbuf();
+	scriptStream.close();
+
+	// touching the file or copying the same script again is not a change
+
+	if(bScriptLoaded && pProgram && (pProgram->uHash == AutoProgram::Hash(scriptText.str())))
+	{
+		return(true);
+	}
+
+	pNewProgram = std::make_shared<AutoProgram>();
+
+	if(!pNewProgram->Compile(scriptText.str()))
+	{
+		printf("Auto script error line %d: %s\n", pNewProgram->iErrorLine, pNewProgram->sError.c_str());
+		SmartDashboard::PutString("Auto Status", "SCRIPT ERROR line " +
+				std::to_string(pNewProgram->iErrorLine) + ": " + pNewProgram->sError);
+
+		// do not run half a script
+
+		std::lock_guard<priority_recursive_mutex> sync(mutexProgram);
+		pProgram.reset();
+		pSelectedRoutine = NULL;
+		bScriptLoaded = false;
+		SmartDashboard::PutBoolean("Script File Loaded", false);
+		return(false);
+	}
+
+	printf("Autonomous script loaded, %d routines\n", (int)pNewProgram->routines.size());
+
+	for(unsigned int i = 0; i < pNewProgram->warnings.size(); i++)
 	{
-		for(int i = 0; i < AUTONOMOUS_SCRIPT_LINES; ++i)
+		printf("Auto script warning %s\n", pNewProgram->warnings[i].c_str());
+	}
+
+	// the script thread holds its own reference to whatever program it is running
+
+	std::lock_guard<priority_recursive_mutex> sync(mutexProgram);
+	pProgram = pNewProgram;
+	pSelectedRoutine = NULL;
+	bScriptLoaded = true;
+	OfferRoutines();
+	SelectRoutine();
+	SmartDashboard::PutString("Auto Status", "Ready to go");
+	SmartDashboard::PutBoolean("Script File Loaded", true);
+	return(true);
+}
+
+void Autonomous::OfferRoutines()
+{
+	std::lock_guard<priority_recursive_mutex> sync(mutexProgram);
+
+	// the chooser cannot forget an entry so only add modes we have not seen
+
+	for(unsigned int i = 0; i < pProgram->routines.size(); i++)
+	{
+		const AutoRoutine &rRoutine = pProgram->routines[i];
+		string sLabel = "MODE " + std::to_string(rRoutine.iMode) + " " + rRoutine.sName;
+
+		if(modesOffered.count(rRoutine.iMode) == 0)
 		{
-			if(!scriptStream.eof())
+			if(modesOffered.empty())
 			{
-				getline(scriptStream, script[i]);
-				//cout << script[i] << endl;
+				pModeChooser->AddDefault(sLabel, rRoutine.iMode);
 			}
 			else
 			{
-				script[i].clear();
+				pModeChooser->AddObject(sLabel, rRoutine.iMode);
 			}
+
+			modesOffered.insert(rRoutine.iMode);
 		}
+	}
+}
+
+void Autonomous::SelectRoutine()
+{
+	const AutoRoutine *pRoutine = NULL;
+	int iMode = pModeChooser->GetSelected();
+
+	std::lock_guard<priority_recursive_mutex> sync(mutexProgram);
 
-		//printf("Autonomous script loaded\n");
-		scriptStream.close();
-	}	
-	else
+	if(pProgram)
 	{
-		//printf("No auto file found\n");
-		bReturn = false;
+		pRoutine = pProgram->FindRoutine(iMode);
+
+		// an old style script with no MODE lines runs whatever is chosen
+
+		if(!pRoutine && (pProgram->routines.size() == 1))
+		{
+			pRoutine = &pProgram->routines[0];
+		}
 	}
 
-	return(bReturn);
+	// all we do is move a pointer, the routine was compiled when the file was loaded
+
+	if(pRoutine != pSelectedRoutine)
+	{
+		pSelectedRoutine = pRoutine;
+		bFilesChanged = true;
+
+		if(pRoutine)
+		{
+			SmartDashboard::PutString("Auto Routine", "MODE " + std::to_string(pRoutine->iMode) +
+					" " + pRoutine->sName);
+		}
+		else
+		{
+			SmartDashboard::PutString("Auto Routine", "MODE " + std::to_string(iMode) + " NOT IN SCRIPT");
+		}
+	}
+}
+
+const AutoRoutine *Autonomous::GetRoutine(std::shared_ptr<const AutoProgram> &rProgram) const
+{
+	// hand back the routine along with a reference that keeps it alive
+
+	std::lock_guard<priority_recursive_mutex> sync(mutexProgram);
+	rProgram = pProgram;
+	return(pSelectedRoutine);
 }
 
 void Autonomous::DoScript()
 {
-	//int loadAttemptTally = 0; //for debugging
+	std::shared_ptr<const AutoProgram> pRunProgram;
+	const AutoRoutine *pRunRoutine;
+
 	SmartDashboard::PutString("Script Line", "DoScript started");
-	SmartDashboard::PutString("Auto Status", "Ready to go");
-	SmartDashboard::PutBoolean("Script File Loaded", false);
-	//printf("DoScript\n");
-	
+
 	while(true)
 	{
 		lineNumber = 0;
 		SmartDashboard::PutNumber("Script Line Number", lineNumber);
 
-		//TODO: LoadScriptFile is called every stinking time we want to check load status! Does this eat time?
-		//We want to load the file while disabled - this allows us to load new scripts
-		if(LoadScriptFile() == false)
+		// sleep until OnStateChange tells us autonomous has started
+
 		{
-			// wait a little and try again, really only useful if when practicing
+			std::unique_lock<std::mutex> lock(mutexState);
+			stateChanged.wait(lock, [this] { return bInAutoMode.load(); });
+		}
 
-			SmartDashboard::PutBoolean("Script File Loaded", false);
-			Wait(1.0);
+		fWakeTime = Timer::GetFPGATimestamp();
+		StartScriptClock();
+
+		// the script is compiled by the message thread whenever the file changes,
+		// here we just grab whatever routine is selected
+
+		pRunRoutine = GetRoutine(pRunProgram);
+
+		if(!pRunRoutine)
+		{
+			printf("No autonomous routine to run\n");
 		}
 		else
 		{
-			SmartDashboard::PutBoolean("Script File Loaded", true);
+			bParallel = false;
 
 			// if there is a script we will execute it some heck or high water!
 
@@ -161,39 +433,54 @@ void Autonomous::DoScript()
 			{
 				SmartDashboard::PutNumber("Script Line Number", lineNumber);
 
-				if (!bPauseAutoMode)
-				{
-					if (lineNumber < AUTONOMOUS_SCRIPT_LINES)
-					{
-						// can we have empty lines?  at the end I guess
+				// handle pausing here and in the Evaluate method
 
-						if (script[lineNumber].empty() == false)
-						{
-							// handle pausing in the Evaluate method
+				WaitWhilePaused();
 
-							SmartDashboard::PutString("Script Line",
-									script[lineNumber].c_str());
+				if (lineNumber < (int)pRunRoutine->instructions.size())
+				{
+					const AutoInstruction &rInstruction = pRunRoutine->instructions[lineNumber];
 
-							if (Evaluate(script[lineNumber]))
-							{
-								SmartDashboard::PutString("Script Line", "<NOT RUNNING>");
-								break;
-							}
-						}
+					SmartDashboard::PutString("Script Line", rInstruction.sText.c_str());
+					pRunningInstruction = &rInstruction;
+					iJumpTo = -1;
+					TimelineStart(rInstruction);
 
-						lineNumber++;
-					}
-					else
+					if (Evaluate(rInstruction))
 					{
+						TimelineFinish();
+						SmartDashboard::PutString("Script Line", "<NOT RUNNING>");
 						break;
 					}
+
+					TimelineFinish();
+
+					// anything we waited on took as long as it took, the next
+					// DELAY counts from when it finished
+
+					if((rInstruction.fTimeout > 0.0) ||
+							(rInstruction.iCommand == AUTO_TOKEN_JOIN) ||
+							(rInstruction.iCommand == AUTO_TOKEN_REPLAY) ||
+							(rInstruction.iCommand == AUTO_TOKEN_PATH) ||
+							(rInstruction.iCommand == AUTO_TOKEN_GEAR_HANG) ||
+							(rInstruction.iCommand == AUTO_TOKEN_WAIT_UNTIL))
+					{
+						clock_gettime(CLOCK_MONOTONIC, &tScriptClock);
+					}
+
+					lineNumber = (iJumpTo >= 0) ? iJumpTo : lineNumber + 1;
+				}
+				else
+				{
+					break;
 				}
 			}
 
-			bInAutoMode = false;
-			Wait(0.1);
+			pRunningInstruction = NULL;
+			ReportDelays();
 		}
-	}
 
-	bInAutoMode = false;
+		std::lock_guard<std::mutex> sync(mutexState);
+		bInAutoMode = false;
+	}
 }
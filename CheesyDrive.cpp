@@ -9,14 +9,31 @@
  */
 
 #include "CheesyDrive.h"
+#include <time.h>
 
-CheesyLoop::CheesyLoop()
+CheesyLoop::CheesyLoop(bool bInline)
 {
-	bOutputEnabled = false;
 	bEnableServo = false;
+	uLastResult = 0;
+	this->bInline = bInline;
+	lastResult = CheesyResult();
+	ResetTiming();
+
+	// time the cheezy code before anything drives with it, then start it over
+	// so the benchmark leaves nothing behind in its filters
+
+	CheezyInit1296();
+	Benchmark(CHEESY_BENCHMARK_ITERATIONS);
 	CheezyInit1296();  // initialize the cheezy drive code base
 
-	pTask = new std::thread(&CheesyLoop::StartTask, this, CHEESY_TASKNAME, CHEESY_PRIORITY);
+	if(bInline)
+	{
+		pTask = NULL;
+	}
+	else
+	{
+		pTask = new std::thread(&CheesyLoop::StartTask, this, CHEESY_TASKNAME, CHEESY_PRIORITY);
+	}
 }
 
 CheesyLoop::~CheesyLoop()
@@ -24,46 +41,160 @@ CheesyLoop::~CheesyLoop()
 	delete pTask;
 }
 
+double CheesyLoop::Now(void)
+{
+	struct timespec tNow;
+
+	clock_gettime(CLOCK_MONOTONIC, &tNow);
+	return(tNow.tv_sec + tNow.tv_nsec * 1.0e-9);
+}
+
+void CheesyLoop::ResetTiming(void)
+{
+	timing.iUpdates = 0;
+	timing.fIterateTotal = 0.0;
+	timing.fIterateWorst = 0.0;
+	timing.fLatencyTotal = 0.0;
+	timing.fLatencyWorst = 0.0;
+}
+
+void CheesyLoop::Benchmark(int iIterations)
+{
+	DrivetrainGoal goal = {};
+	DrivetrainPosition position = {};
+	DrivetrainStatus status;
+	double fStart;
+	double fTime;
+	double fTotal = 0.0;
+	double fWorst = 0.0;
+
+	// a slow turn on the spot so the filters have something to do, no output
+	// so nothing could ever reach the motors
+
+	goal.throttle = 0.5;
+	goal.steering = 0.3;
+	position.battery_voltage = 12.0;
+
+	for(int i = 0; i < iIterations; i++)
+	{
+		position.left_encoder = i * 0.001;
+		position.right_encoder = i * 0.0005;
+
+		fStart = Now();
+		CheezyIterate1296(&goal, &position, NULL, &status);
+		fTime = Now() - fStart;
+
+		fTotal += fTime;
+		fWorst = (fTime > fWorst) ? fTime : fWorst;
+	}
+
+	printf("CheezyIterate1296 %d iterations, average %0.1f us, worst %0.1f us\n",
+			iIterations, fTotal / iIterations * 1.0e6, fWorst * 1.0e6);
+}
+
 void CheesyLoop::Run(void)
 {
+	CheesyInput input = {};
+	CheesyResult result = {};
+	int iStalePeriods = CHEESY_STALE_PERIODS;
+	double fStart;
+
 	 while(true)
 	 {
-		 Wait(0.005);
+		 Wait(CHEESY_PERIOD);
+
+		// keep iterating on the last goal we had, it is the newest there is
+
+		if(inputs.Read(input))
+		{
+			iStalePeriods = 0;
+		}
+		else if(iStalePeriods < CHEESY_STALE_PERIODS)
+		{
+			iStalePeriods++;
+		}
+
+		fStart = Now();
 
-		if(bOutputEnabled)
+		if(input.bEnabled && (iStalePeriods < CHEESY_STALE_PERIODS))
 		{
-			 std::lock_guard<priority_recursive_mutex> sync(mutexData);
-			 CheezyIterate1296(&currentGoal,
-					 &currentPosition,
-					 &currentOutput,
-					 &currentStatus);
+			 CheezyIterate1296(&input.goal,
+					 &input.position,
+					 &result.output,
+					 &result.status);
 		}
 		else
 		{
-			 std::lock_guard<priority_recursive_mutex> sync(mutexData);
-			 CheezyIterate1296(&currentGoal,
-					 &currentPosition,
+			 CheezyIterate1296(&input.goal,
+					 &input.position,
 					 NULL,
-					 &currentStatus);
+					 &result.status);
 		}
+
+		result.fIterateTime = Now() - fStart;
+		result.fSensorTime = input.fSensorTime;
+		results.Write(result);
 	 }
 }
 
 
-void CheesyLoop::Update(const DrivetrainGoal &goal,
+bool CheesyLoop::Update(const DrivetrainGoal &goal,
     const DrivetrainPosition &position,
     DrivetrainOutput &output,
     DrivetrainStatus &status,
-	bool bEnabled)
+	bool bEnabled,
+	double fSensorTime)
 {
-	std::lock_guard<priority_recursive_mutex> sync(mutexData);
+	CheesyInput input;
+	CheesyResult result;
+	unsigned uSequence;
+	bool bFresh;
+	double fStart;
 
-	bOutputEnabled = bEnabled;
-	currentGoal = goal;
-	currentPosition = position;
-	output = currentOutput;
-	status = currentStatus;
-}
+	if(bInline)
+	{
+		// one step on the position we were just handed, stepping again on the
+		// same position would tell the filters the robot stood still
+
+		fStart = Now();
+		CheezyIterate1296(&goal, &position, bEnabled ? &lastResult.output : NULL, &lastResult.status);
+		lastResult.fIterateTime = Now() - fStart;
+
+		lastResult.fSensorTime = fSensorTime;
+		result = lastResult;
+		bFresh = true;
+	}
+	else
+	{
+		input.goal = goal;
+		input.position = position;
+		input.bEnabled = bEnabled;
+		input.fSensorTime = fSensorTime;
+		inputs.Write(input);
 
+		// the result is from the loop's last pass, tell the caller if it has not
+		// run since the last time we asked
 
+		results.Read(result, &uSequence);
+		bFresh = (uSequence != uLastResult);
+		uLastResult = uSequence;
+	}
 
+	// the latency is from when the sensors behind this output were read, on
+	// the loop thread that is usually an update or two ago
+
+	if(bEnabled && (result.fSensorTime > 0.0))
+	{
+		double fLatency = Now() - result.fSensorTime;
+
+		timing.iUpdates++;
+		timing.fIterateTotal += result.fIterateTime;
+		timing.fIterateWorst = (result.fIterateTime > timing.fIterateWorst) ? result.fIterateTime : timing.fIterateWorst;
+		timing.fLatencyTotal += fLatency;
+		timing.fLatencyWorst = (fLatency > timing.fLatencyWorst) ? fLatency : timing.fLatencyWorst;
+	}
+
+	output = result.output;
+	status = result.status;
+	return(bFresh);
+}
@@ -17,6 +17,7 @@
 //Robot
 #include <WPILib.h>
 #include "RobotParams.h"
+#include "TripleBuffer.h"
 
 // Structures to carry information about the drivetrain - must match cheezy code
 
@@ -61,10 +62,50 @@ struct DrivetrainStatus {
     bool output_was_capped;
   };
 
+// the drivetrain stops sending when it is not driving with cheesy, after this
+// many periods without a new goal we stop driving the outputs
+const int CHEESY_STALE_PERIODS = 20;
+
+// true steps the cheezy code in the drivetrain task on the sensors it just
+// read, false runs it on its own thread every 5 ms
+const bool CHEESY_INLINE = false;
+
+// the cheezy code is tuned for a 5 ms step, run inline it steps once for each
+// update so it is only right if the drivetrain updates it that often
+const double CHEESY_PERIOD = 0.005;
+
+// how many iterations the startup benchmark times
+const int CHEESY_BENCHMARK_ITERATIONS = 1000;
+
+///What the drivetrain hands the loop
+struct CheesyInput {
+	DrivetrainGoal goal;
+	DrivetrainPosition position;
+	bool bEnabled;
+	double fSensorTime;		//!< when the position was read, seconds
+};
+
+///What the loop hands back
+struct CheesyResult {
+	DrivetrainOutput output;
+	DrivetrainStatus status;
+	double fSensorTime;		//!< when the position this came from was read
+	double fIterateTime;	//!< how long CheezyIterate1296 took, seconds
+};
+
+///How long the loop is taking, kept by Update
+struct CheesyTiming {
+	int iUpdates;
+	double fIterateTotal;	//!< seconds in CheezyIterate1296
+	double fIterateWorst;
+	double fLatencyTotal;	//!< seconds from reading the sensors to the output coming back
+	double fLatencyWorst;
+};
+
 class CheesyLoop {
 
  public:
-	CheesyLoop();
+	CheesyLoop(bool bInline = false);
  	~CheesyLoop();
 
  	bool bEnableServo;
@@ -79,25 +120,42 @@ class CheesyLoop {
 
 	void Run(void);
 
- 	void Update(const DrivetrainGoal &goal,
+ 	bool Update(const DrivetrainGoal &goal,
  	    const DrivetrainPosition &position,
  	    DrivetrainOutput &output,
  	    DrivetrainStatus &status,
- 		bool bEnabled);
+ 		bool bEnabled,
+ 		double fSensorTime);
+
+ 	bool IsInline(void) const { return(bInline); };
+ 	void GetTiming(CheesyTiming &rTiming) const { rTiming = timing; };
+ 	void ResetTiming(void);
+
+ 	static double Now(void);
+
  private:
- 	struct DrivetrainGoal currentGoal;
- 	struct DrivetrainPosition currentPosition;
- 	struct DrivetrainOutput currentOutput;
- 	struct DrivetrainStatus currentStatus;
- 	std::thread* pTask;
+ 	std::thread* pTask;		//!< NULL when running inline
+
+ 	// inline the drivetrain steps the cheezy code itself on the position it
+ 	// just read, otherwise the loop thread steps it every 5 ms on whatever
+ 	// position it was handed last
+
+ 	bool bInline;
+ 	CheesyResult lastResult;	//!< inline only, what we hand out when there is nothing new
+ 	CheesyTiming timing;		//!< only Update touches this
+
+ 	// the drivetrain writes inputs and reads results, the loop thread the other
+ 	// way round, neither ever waits on the other
 
- 	mutable priority_recursive_mutex mutexData;
- 	bool bOutputEnabled;
+ 	TripleBuffer<CheesyInput> inputs;
+ 	TripleBuffer<CheesyResult> results;
+ 	unsigned uLastResult;		//!< sequence of the last result Update handed out
 
  	void Iterate(const DrivetrainGoal *goal,
  				 const DrivetrainPosition *position,
  		         DrivetrainOutput *output,
  		         DrivetrainStatus *status);
+ 	void Benchmark(int iIterations);
  };
 
 extern "C" void CheezyInit1296(void);
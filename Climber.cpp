@@ -14,6 +14,7 @@
 #include <Climber.h>
 #include <ComponentBase.h>
 #include <RobotParams.h>
+#include "PowerMonitor.h"
 #include "WPILib.h"
 
 //Robot
@@ -106,15 +107,15 @@ void Climber::Run()
 	//TODO add command cases for Climber
 			case COMMAND_CLIMBER_UP:
 #ifndef USING_SOFTWARE_ROBOT
-				pClimberMotor1->Set(localMessage.params.climber.ClimbUp);
-				pClimberMotor2->Set(localMessage.params.climber.ClimbUp*-1);
+				pClimberMotor1->Set(PowerMonitor::GetInstance()->Compensate(localMessage.params.climber.ClimbUp, pClimberMotor1, POWER_CLIMBER_CURRENT));
+				pClimberMotor2->Set(PowerMonitor::GetInstance()->Compensate(localMessage.params.climber.ClimbUp*-1, pClimberMotor2, POWER_CLIMBER_CURRENT));
 #endif // USING_SOFTWARE_ROBOT
 				break;
 
 			case COMMAND_CLIMBER_DOWN:
 #ifndef USING_SOFTWARE_ROBOT
-				pClimberMotor1->Set(localMessage.params.climber.ClimbDown);
-				pClimberMotor2->Set(localMessage.params.climber.ClimbDown*-1);
+				pClimberMotor1->Set(PowerMonitor::GetInstance()->Compensate(localMessage.params.climber.ClimbDown, pClimberMotor1, POWER_CLIMBER_CURRENT));
+				pClimberMotor2->Set(PowerMonitor::GetInstance()->Compensate(localMessage.params.climber.ClimbDown*-1, pClimberMotor2, POWER_CLIMBER_CURRENT));
 #endif // USING_SOFTWARE_ROBOT
 				break;
 
@@ -149,8 +150,8 @@ void Climber::AutoClimber(float time) {
 		while (true) {
 			if ((pAutoTimer->Get() < time) && inAuto) {
 #ifndef USING_SOFTWARE_ROBOT
-				pClimberMotor1->Set(localMessage.params.climber.ClimbUp);
-				pClimberMotor2->Set(-localMessage.params.climber.ClimbUp);
+				pClimberMotor1->Set(PowerMonitor::GetInstance()->Compensate(localMessage.params.climber.ClimbUp, pClimberMotor1, POWER_CLIMBER_CURRENT));
+				pClimberMotor2->Set(PowerMonitor::GetInstance()->Compensate(-localMessage.params.climber.ClimbUp, pClimberMotor2, POWER_CLIMBER_CURRENT));
 #endif // USING_SOFTWARE_ROBOT
 			}
 			else
@@ -24,6 +24,7 @@ class RhsRobot;
 ComponentBase::ComponentBase(const char* newComponentName, const char *queueName, int priority)
 {	
 	iLoop = 0;
+	fReceived = 0.0;
 	iPipeRcv = -1;
 	iPipeXmt = -1;
 
@@ -71,8 +72,15 @@ void ComponentBase::ReceiveMessage()			//Receives a message and copies it into l
 	}
 	else
 	{
+		struct timespec tNow;
+
 		localMessage.command = COMMAND_SYSTEM_MSGTIMEOUT;
 		read(iPipeRcv, (char*)&localMessage, sizeof(RobotMessage));
+
+		// remembered so a response can tell autonomous when we got the command
+
+		clock_gettime(CLOCK_MONOTONIC, &tNow);
+		fReceived = tNow.tv_sec + tNow.tv_nsec / 1.0e9;
 	}
 }
 
@@ -116,15 +124,24 @@ void ComponentBase::DoWork()
 		iLoop++;
 	}
 }
-void ComponentBase::SendCommandResponse(MessageCommand command)
+void ComponentBase::SendCommandResponse(MessageCommand command, AutoCompletion eReason)
+{
+	SendCommandResponse(localMessage, fReceived, command, eReason);
+}
+
+void ComponentBase::SendCommandResponse(const RobotMessage &rCommand, double fCommandReceived,
+		MessageCommand command, AutoCompletion eReason)
 {
 	RobotMessage replyMessage;
 
 	replyMessage.command = command;
+	replyMessage.uReplyId = rCommand.uReplyId;
+	replyMessage.params.response.eReason = eReason;
+	replyMessage.params.response.fReceived = fCommandReceived;
 
 	//Send a message back to auto to tell it that code is done.
 
-	int iPipeXmt = open(localMessage.replyQ, O_WRONLY);
+	int iPipeXmt = open(rCommand.replyQ, O_WRONLY);
 	assert(iPipeXmt > 0);
 
 	write(iPipeXmt, (char*) &replyMessage, sizeof(RobotMessage));
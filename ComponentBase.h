@@ -46,12 +46,16 @@ protected:
 	RobotMessage localMessage;
 	MessageCommand lastCommand;//used to detect changes in commands sent
 	int iLoop;
+	double fReceived;	//CLOCK_MONOTONIC seconds when localMessage was read
 
 	virtual void OnStateChange() = 0;
 	virtual void Run() = 0;
 
 	///used to send a message back to autonomous or whatever to notify completion of a function
-	void SendCommandResponse(MessageCommand);
+	void SendCommandResponse(MessageCommand, AutoCompletion eReason = AUTO_COMPLETE_DONE);
+	///same for a command we remembered and finished after other messages came in
+	void SendCommandResponse(const RobotMessage &rCommand, double fCommandReceived, MessageCommand,
+			AutoCompletion eReason = AUTO_COMPLETE_DONE);
 
 private:
 	const float fUpdateDelay = .15;
@@ -0,0 +1,276 @@
+/** \file
+ * Works out the drivetrain's gains from how it actually drives.
+ *
+ * The fit is ordinary least squares on the three terms, the normal equations
+ * are only 3x3 so we just eliminate.  The file is plain text, one name and
+ * value a line, so it can be read and fixed by hand on the roboRIO.
+ */
+
+#include <DriveCharacterize.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+void DriveCharacterize::Differentiate(DriveSample *pSamples, int iCount)
+{
+	int iBefore;
+	int iAfter;
+	float fTime;
+
+	// a difference over a few samples either way, the encoder velocity is
+	// too noisy to difference one period at a time
+
+	for(int i = 0; i < iCount; i++)
+	{
+		iBefore = std::max(i - DRIVECHARACTERIZE_SMOOTH, 0);
+		iAfter = std::min(i + DRIVECHARACTERIZE_SMOOTH, iCount - 1);
+		fTime = pSamples[iAfter].fTime - pSamples[iBefore].fTime;
+
+		pSamples[i].fAccel = (fTime > 0.0) ?
+				(pSamples[iAfter].fVelocity - pSamples[iBefore].fVelocity) / fTime : 0.0;
+	}
+}
+
+bool DriveCharacterize::Fit(const DriveSample *pSamples, int iCount, DriveModel &rModel)
+{
+	double fNormal[3][4] = {};
+	double fTerm[3];
+	double fSolution[3];
+	double fMean = 0.0;
+	double fTotal = 0.0;
+	double fResidual = 0.0;
+	double fError;
+	int iUsed = 0;
+
+	rModel.fKs = 0.0;
+	rModel.fKv = 0.0;
+	rModel.fKa = 0.0;
+	rModel.fRSquared = 0.0;
+	rModel.iSamples = 0;
+
+	// build up the normal equations with the voltage as the last column
+
+	for(int i = 0; i < iCount; i++)
+	{
+		if(fabs(pSamples[i].fVelocity) < DRIVECHARACTERIZE_MIN_SPEED)
+		{
+			continue;
+		}
+
+		fTerm[0] = (pSamples[i].fVelocity > 0.0) ? 1.0 : -1.0;
+		fTerm[1] = pSamples[i].fVelocity;
+		fTerm[2] = pSamples[i].fAccel;
+
+		for(int j = 0; j < 3; j++)
+		{
+			for(int k = 0; k < 3; k++)
+			{
+				fNormal[j][k] += fTerm[j] * fTerm[k];
+			}
+
+			fNormal[j][3] += fTerm[j] * pSamples[i].fVoltage;
+		}
+
+		fMean += pSamples[i].fVoltage;
+		iUsed++;
+	}
+
+	if(iUsed < DRIVECHARACTERIZE_MIN_SAMPLES)
+	{
+		return(false);
+	}
+
+	// Gaussian elimination, swapping rows for the biggest pivot
+
+	for(int j = 0; j < 3; j++)
+	{
+		int iPivot = j;
+
+		for(int k = j + 1; k < 3; k++)
+		{
+			if(fabs(fNormal[k][j]) > fabs(fNormal[iPivot][j]))
+			{
+				iPivot = k;
+			}
+		}
+
+		if(fabs(fNormal[iPivot][j]) < 1.0e-9)
+		{
+			return(false);
+		}
+
+		for(int k = 0; k < 4; k++)
+		{
+			std::swap(fNormal[j][k], fNormal[iPivot][k]);
+		}
+
+		for(int k = j + 1; k < 3; k++)
+		{
+			double fFactor = fNormal[k][j] / fNormal[j][j];
+
+			for(int l = j; l < 4; l++)
+			{
+				fNormal[k][l] -= fFactor * fNormal[j][l];
+			}
+		}
+	}
+
+	for(int j = 2; j >= 0; j--)
+	{
+		fSolution[j] = fNormal[j][3];
+
+		for(int k = j + 1; k < 3; k++)
+		{
+			fSolution[j] -= fNormal[j][k] * fSolution[k];
+		}
+
+		fSolution[j] /= fNormal[j][j];
+	}
+
+	// how well it fits, a low number means the logs were bad, not the robot
+
+	fMean /= iUsed;
+
+	for(int i = 0; i < iCount; i++)
+	{
+		if(fabs(pSamples[i].fVelocity) < DRIVECHARACTERIZE_MIN_SPEED)
+		{
+			continue;
+		}
+
+		fError = pSamples[i].fVoltage - (fSolution[0] * ((pSamples[i].fVelocity > 0.0) ? 1.0 : -1.0) +
+				fSolution[1] * pSamples[i].fVelocity + fSolution[2] * pSamples[i].fAccel);
+		fResidual += fError * fError;
+		fTotal += (pSamples[i].fVoltage - fMean) * (pSamples[i].fVoltage - fMean);
+	}
+
+	rModel.fKs = fSolution[0];
+	rModel.fKv = fSolution[1];
+	rModel.fKa = fSolution[2];
+	rModel.fRSquared = (fTotal > 0.0) ? 1.0 - fResidual / fTotal : 0.0;
+	rModel.iSamples = iUsed;
+
+	// it has to take some voltage to go and some more to go faster
+
+	return((rModel.fKs >= 0.0) && (rModel.fKv > 0.0) && (rModel.fKa >= 0.0));
+}
+
+void DriveCharacterize::DeriveGains(const DriveModel &rModel, float fFeetPerNative, TalonGains &rGains)
+{
+	float fThrottlePerVolt = DRIVECHARACTERIZE_FULL_THROTTLE / DRIVECHARACTERIZE_NOMINAL_VOLTAGE;
+	float fProportional;
+
+	// F is the throttle that holds a speed, the Talon has no term for kS so the
+	// P term makes that up
+
+	rGains.fF = fThrottlePerVolt * rModel.fKv * fFeetPerNative;
+
+	// the side on its own settles at kV/kA, P speeds that up to the bandwidth
+
+	fProportional = std::max(DRIVECHARACTERIZE_BANDWIDTH * rModel.fKa - rModel.fKv, 0.0f);
+	rGains.fP = fThrottlePerVolt * fProportional * fFeetPerNative;
+
+	// same ratios we tuned by hand in Drivetrain.h
+
+	rGains.fI = rGains.fP / 100.0;
+	rGains.fD = rGains.fP * 10.0;
+}
+
+bool DriveCharacterize::Save(const char *szPath, const DriveGains &rGains)
+{
+	FILE *pFile = fopen(szPath, "w");
+
+	if(!pFile)
+	{
+		return(false);
+	}
+
+	fprintf(pFile, "# drivetrain characterization, volts and feet/second\n");
+	fprintf(pFile, "left_ks %f\nleft_kv %f\nleft_ka %f\nleft_r2 %f\n",
+			rGains.leftModel.fKs, rGains.leftModel.fKv, rGains.leftModel.fKa, rGains.leftModel.fRSquared);
+	fprintf(pFile, "right_ks %f\nright_kv %f\nright_ka %f\nright_r2 %f\n",
+			rGains.rightModel.fKs, rGains.rightModel.fKv, rGains.rightModel.fKa, rGains.rightModel.fRSquared);
+	fprintf(pFile, "# Talon velocity loop\n");
+	fprintf(pFile, "left_p %f\nleft_i %f\nleft_d %f\nleft_f %f\n",
+			rGains.leftTalon.fP, rGains.leftTalon.fI, rGains.leftTalon.fD, rGains.leftTalon.fF);
+	fprintf(pFile, "right_p %f\nright_i %f\nright_d %f\nright_f %f\n",
+			rGains.rightTalon.fP, rGains.rightTalon.fI, rGains.rightTalon.fD, rGains.rightTalon.fF);
+
+	return((fclose(pFile) == 0));
+}
+
+bool DriveCharacterize::Load(const char *szPath, DriveGains &rGains)
+{
+	struct GainName {
+		const char *szName;
+		float *pValue;
+	};
+
+	GainName names[] = {
+		{ "left_ks", &rGains.leftModel.fKs },
+		{ "left_kv", &rGains.leftModel.fKv },
+		{ "left_ka", &rGains.leftModel.fKa },
+		{ "left_r2", &rGains.leftModel.fRSquared },
+		{ "right_ks", &rGains.rightModel.fKs },
+		{ "right_kv", &rGains.rightModel.fKv },
+		{ "right_ka", &rGains.rightModel.fKa },
+		{ "right_r2", &rGains.rightModel.fRSquared },
+		{ "left_p", &rGains.leftTalon.fP },
+		{ "left_i", &rGains.leftTalon.fI },
+		{ "left_d", &rGains.leftTalon.fD },
+		{ "left_f", &rGains.leftTalon.fF },
+		{ "right_p", &rGains.rightTalon.fP },
+		{ "right_i", &rGains.rightTalon.fI },
+		{ "right_d", &rGains.rightTalon.fD },
+		{ "right_f", &rGains.rightTalon.fF },
+	};
+	const int iNames = sizeof(names) / sizeof(names[0]);
+	bool bFound[iNames] = {};
+	char szLine[128];
+	char szName[64];
+	float fValue;
+	FILE *pFile = fopen(szPath, "r");
+
+	if(!pFile)
+	{
+		return(false);
+	}
+
+	while(fgets(szLine, sizeof(szLine), pFile))
+	{
+		if((szLine[0] == '#') || (sscanf(szLine, "%63s %f", szName, &fValue) != 2))
+		{
+			continue;
+		}
+
+		for(int i = 0; i < iNames; i++)
+		{
+			if(strcmp(szName, names[i].szName) == 0)
+			{
+				*names[i].pValue = fValue;
+				bFound[i] = true;
+			}
+		}
+	}
+
+	fclose(pFile);
+
+	// half a file or a NaN would leave a side with no velocity loop
+
+	for(int i = 0; i < iNames; i++)
+	{
+		if(!bFound[i] || !isfinite(*names[i].pValue))
+		{
+			printf("%s has no good %s\n", szPath, names[i].szName);
+			return(false);
+		}
+	}
+
+	rGains.leftModel.iSamples = 0;
+	rGains.rightModel.iSamples = 0;
+
+	return((rGains.leftTalon.fF > 0.0) && (rGains.rightTalon.fF > 0.0) &&
+			(rGains.leftTalon.fP >= 0.0) && (rGains.rightTalon.fP >= 0.0));
+}
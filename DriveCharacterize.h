@@ -0,0 +1,77 @@
+/** \file
+ * Works out the drivetrain's gains from how it actually drives.
+ *
+ * Each side of the drive is modelled as
+ *
+ *     volts = kS * sign(velocity) + kV * velocity + kA * acceleration
+ *
+ * kS is what it takes to get moving at all, kV what it takes to keep going at
+ * a speed and kA what it takes to speed up.  The test mode routine in
+ * DrivetrainCharacterize.cpp logs voltage and velocity while it ramps the
+ * voltage up slowly (where acceleration is nothing) and while it steps it (where
+ * acceleration is most of it), Fit solves for the three by least squares and
+ * DeriveGains turns them into Talon velocity loop PIDF.  The results go into a
+ * text file Drivetrain reads at startup instead of the constants in
+ * Drivetrain.h.
+ *
+ * Speeds are feet/second and voltages volts.  Nothing in here depends on
+ * WPILib.
+ */
+
+#ifndef DRIVECHARACTERIZE_H
+#define DRIVECHARACTERIZE_H
+
+const char* const DRIVECHARACTERIZE_FILEPATH = "/home/lvuser/DriveGains.txt";
+const int DRIVECHARACTERIZE_MAX_SAMPLES = 10000;	// 50 seconds of tests at the control rate
+const int DRIVECHARACTERIZE_MIN_SAMPLES = 100;		// fewer than this and the fit means nothing
+const int DRIVECHARACTERIZE_SMOOTH = 4;				// samples either side when working out acceleration
+const float DRIVECHARACTERIZE_MIN_SPEED = 0.1;		// feet/second, slower than this is stiction and noise
+const float DRIVECHARACTERIZE_BANDWIDTH = 10.0;		// 1/seconds, how fast the velocity loop should pull in
+const float DRIVECHARACTERIZE_NOMINAL_VOLTAGE = 12.0;
+const float DRIVECHARACTERIZE_FULL_THROTTLE = 1023.0;	// Talon closed loop output for full voltage
+
+///One control period of a test on one side
+struct DriveSample {
+	float fTime;			//!< seconds since the test started
+	float fVoltage;			//!< volts the Talon put out, signed the way the side went
+	float fVelocity;		//!< feet/second, forward positive
+	float fAccel;			//!< feet/second/second, filled in by Differentiate
+};
+
+///What it takes to drive one side
+struct DriveModel {
+	float fKs;				//!< volts
+	float fKv;				//!< volts per foot/second
+	float fKa;				//!< volts per foot/second/second
+	float fRSquared;		//!< how much of the voltage the fit explains, 1 is all of it
+	int iSamples;
+};
+
+///Talon velocity loop gains in Talon units
+struct TalonGains {
+	float fP;
+	float fI;
+	float fD;
+	float fF;
+};
+
+///Everything the characterization file holds
+struct DriveGains {
+	DriveModel leftModel;
+	DriveModel rightModel;
+	TalonGains leftTalon;
+	TalonGains rightTalon;
+};
+
+class DriveCharacterize
+{
+public:
+	static void Differentiate(DriveSample *pSamples, int iCount);
+	static bool Fit(const DriveSample *pSamples, int iCount, DriveModel &rModel);
+	static void DeriveGains(const DriveModel &rModel, float fFeetPerNative, TalonGains &rGains);
+
+	static bool Save(const char *szPath, const DriveGains &rGains);
+	static bool Load(const char *szPath, DriveGains &rGains);
+};
+
+#endif  // DRIVECHARACTERIZE_H
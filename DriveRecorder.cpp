@@ -0,0 +1,160 @@
+/** \file
+ * Records the commands the driver sends in teleop so autonomous can play them back.
+ *
+ * Record runs in the main robot task every time it sends a message so all it
+ * does is copy into the buffer.  The file is only touched when recording stops
+ * and when a recording is loaded, both while the robot is not driving.
+ */
+
+#include <DriveRecorder.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+DriveRecorder::DriveRecorder()
+{
+	pRecords = new RecordedCommand[DRIVERECORDER_MAX_RECORDS];
+	iCount = 0;
+	bRecording = false;
+	bFull = false;
+	tStart.tv_sec = 0;
+	tStart.tv_nsec = 0;
+	tLoadedModified = 0;
+}
+
+DriveRecorder::~DriveRecorder()
+{
+	delete[] pRecords;
+}
+
+void DriveRecorder::Start()
+{
+	clock_gettime(CLOCK_MONOTONIC, &tStart);
+	iCount = 0;
+	bFull = false;
+	bRecording = true;
+
+	// whatever was loaded for playback is gone now
+
+	sLoadedPath.clear();
+}
+
+void DriveRecorder::Record(RecordTarget eTarget, const RobotMessage &rMessage)
+{
+	struct timespec tNow;
+	RecordedCommand *pRecord;
+
+	if(!bRecording)
+	{
+		return;
+	}
+
+	if(iCount >= DRIVERECORDER_MAX_RECORDS)
+	{
+		if(!bFull)
+		{
+			printf("DriveRecorder full after %d commands\n", iCount);
+			bFull = true;
+		}
+
+		return;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &tNow);
+
+	pRecord = &pRecords[iCount++];
+	pRecord->uMicroseconds = (tNow.tv_sec - tStart.tv_sec) * 1000000 + (tNow.tv_nsec - tStart.tv_nsec) / 1000;
+	pRecord->uCommand = rMessage.command;
+	pRecord->uTarget = eTarget;
+	pRecord->uSpare = 0;
+	pRecord->params = rMessage.params;
+}
+
+bool DriveRecorder::Stop(const char *szPath)
+{
+	RecordingHeader header;
+	FILE *pFile;
+	bool bReturn;
+
+	if(!bRecording)
+	{
+		return(false);
+	}
+
+	bRecording = false;
+
+	header.uMagic = DRIVERECORDER_MAGIC;
+	header.uVersion = DRIVERECORDER_VERSION;
+	header.uRecordSize = sizeof(RecordedCommand);
+	header.uCount = iCount;
+	header.uDuration = GetDuration();
+
+	pFile = fopen(szPath, "wb");
+
+	if(!pFile)
+	{
+		printf("DriveRecorder could not write %s\n", szPath);
+		return(false);
+	}
+
+	bReturn = (fwrite(&header, sizeof(header), 1, pFile) == 1) &&
+			(fwrite(pRecords, sizeof(RecordedCommand), iCount, pFile) == (size_t)iCount);
+	fclose(pFile);
+
+	printf("DriveRecorder wrote %d commands, %0.2f seconds, to %s\n", iCount,
+			header.uDuration / 1.0e6, szPath);
+	return(bReturn);
+}
+
+bool DriveRecorder::Load(const char *szPath)
+{
+	RecordingHeader header;
+	struct stat fileStat;
+	FILE *pFile;
+	bool bReturn;
+
+	if(bRecording || (stat(szPath, &fileStat) != 0))
+	{
+		return(false);
+	}
+
+	// we only read the file again if it changed
+
+	if((sLoadedPath == szPath) && (tLoadedModified == fileStat.st_mtime))
+	{
+		return(true);
+	}
+
+	sLoadedPath.clear();
+	iCount = 0;
+
+	pFile = fopen(szPath, "rb");
+
+	if(!pFile)
+	{
+		return(false);
+	}
+
+	// a file from an older build has a different MessageParams, do not guess
+
+	if((fread(&header, sizeof(header), 1, pFile) != 1) || (header.uMagic != DRIVERECORDER_MAGIC) ||
+			(header.uVersion != DRIVERECORDER_VERSION) || (header.uRecordSize != sizeof(RecordedCommand)) ||
+			(header.uCount > (uint32_t)DRIVERECORDER_MAX_RECORDS))
+	{
+		printf("DriveRecorder %s is not a recording from this build\n", szPath);
+		fclose(pFile);
+		return(false);
+	}
+
+	bReturn = (fread(pRecords, sizeof(RecordedCommand), header.uCount, pFile) == header.uCount);
+	fclose(pFile);
+
+	if(bReturn)
+	{
+		iCount = header.uCount;
+		sLoadedPath = szPath;
+		tLoadedModified = fileStat.st_mtime;
+	}
+
+	return(bReturn);
+}
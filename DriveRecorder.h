@@ -0,0 +1,81 @@
+/** \file
+ * Records the commands the driver sends in teleop so autonomous can play them back.
+ *
+ * While recording, RhsRobot::Run hands every message it sends to the
+ * drivetrain, gear floor intake and climber to Record, which copies it into a
+ * buffer allocated up front along with the time since recording started.  When
+ * teleop ends the buffer is written out as a small header followed by fixed
+ * size records.  The REPLAY script command loads the file and sends the same
+ * messages at the same times.
+ *
+ * Nothing in here depends on WPILib so the tools can read recordings too.
+ */
+
+#ifndef DRIVERECORDER_H
+#define DRIVERECORDER_H
+
+#include <RobotMessage.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <string>
+
+const char* const DRIVERECORDER_FILEPATH = "/home/lvuser/RhsRecording.bin";
+const int DRIVERECORDER_MAX_RECORDS = 20000;		// a little over a minute of teleop
+const uint32_t DRIVERECORDER_MAGIC = 0x52485352;	// "RHSR"
+const uint16_t DRIVERECORDER_VERSION = 1;
+
+///Where a recorded message goes
+typedef enum RecordTarget
+{
+	RECORD_DRIVETRAIN,
+	RECORD_GEARFLOOR,
+	RECORD_CLIMBER,
+	RECORD_LAST
+} RecordTarget;
+
+///Start of a recording file
+struct RecordingHeader {
+	uint32_t uMagic;
+	uint16_t uVersion;
+	uint16_t uRecordSize;		//!< sizeof(RecordedCommand), changes if MessageParams does
+	uint32_t uCount;
+	uint32_t uDuration;			//!< microseconds from the start to the last record
+};
+
+///One message the driver sent
+struct RecordedCommand {
+	uint32_t uMicroseconds;		//!< since recording started
+	uint16_t uCommand;			//!< MessageCommand
+	uint8_t uTarget;			//!< RecordTarget
+	uint8_t uSpare;
+	MessageParams params;
+};
+
+class DriveRecorder
+{
+public:
+	DriveRecorder();
+	~DriveRecorder();
+
+	void Start();
+	void Record(RecordTarget eTarget, const RobotMessage &rMessage);
+	bool Stop(const char *szPath);
+	bool IsRecording() const { return(bRecording); };
+
+	bool Load(const char *szPath);
+	int GetCount() const { return(iCount); };
+	const RecordedCommand &GetRecord(int iRecord) const { return(pRecords[iRecord]); };
+	uint32_t GetDuration() const { return(iCount ? pRecords[iCount - 1].uMicroseconds : 0); };
+
+private:
+	RecordedCommand *pRecords;
+	int iCount;
+	bool bRecording;
+	bool bFull;
+	struct timespec tStart;
+	std::string sLoadedPath;		//!< file in pRecords, empty if none
+	time_t tLoadedModified;
+};
+
+#endif  // DRIVERECORDER_H
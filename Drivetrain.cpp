@@ -21,8 +21,10 @@
 #include <algorithm>
 
 #include "Drivetrain.h"
+#include "AutoSensors.h"
 #include "CheesyDrive.h"
 #include "PixyCam.h"
+#include "PowerMonitor.h"
 #include "RobotParams.h"
 
 
@@ -33,6 +35,8 @@ Drivetrain::Drivetrain() :
 				DRIVETRAIN_PRIORITY) {
 
 	fBatteryVoltage = 12.0;
+	bStateSpaceDrive = false;
+	fWheelSpeedTime = 0.0;
 
 	// create all the objects used in this thread
 
@@ -68,6 +72,15 @@ Drivetrain::Drivetrain() :
 	pRightMotorSlave->SetControlMode(CANSpeedController::kFollower);
 	pRightMotorSlave->Set(CAN_DRIVETRAIN_RIGHT_MOTOR);
 
+	// gains from the last characterization beat the ones in Drivetrain.h
+
+	DriveGains gains;
+
+	if(DriveCharacterize::Load(DRIVECHARACTERIZE_FILEPATH, gains))
+	{
+		ApplyGains(gains);
+	}
+
 	wpi_assert(pLeftMotor->IsAlive());
 	wpi_assert(pRightMotor->IsAlive());
 	wpi_assert(pLeftMotorSlave->IsAlive());
@@ -86,8 +99,31 @@ Drivetrain::Drivetrain() :
 	bMeasuredMove = false;
 	bMeasuredMoveProximity = false;
 	bInAuto = false;
+	bBlendOut = false;
+	bBlending = false;
 
 	fStraightDriveDistance = 0.0;
+	fExitSpeed = 0.0;
+	fBlendStart = 0.0;
+	fArcSpeed = 0.0;
+	fArcRadius = 0.0;
+	fHandoverSpeed = 0.0;
+	fProfileStart = 0.0;
+	fPoseX = 0.0;
+	fPoseY = 0.0;
+	fPoseHeading = 0.0;
+	fPathStartX = 0.0;
+	fPathStartY = 0.0;
+	fPathStartHeading = 0.0;
+	fLastPathSample = 0.0;
+	bFollowingPath = false;
+	fMoveAccel = fProfileAccel;
+	fMoveJerk = fProfileJerk;
+	fTurnSettleTime = fTurnSettle;
+	fTurnIntegral = 0.0;
+	fSettleStart = -1.0;
+	iStartPosition = 0;
+	iStartPositionLeft = 0;
 
 	pAutoTimer = new Timer();
 	wpi_assert(pAutoTimer);
@@ -100,15 +136,31 @@ Drivetrain::Drivetrain() :
 	pGyro = new ADXRS453Z();
 	wpi_assert(pGyro);
 
+	pOdometry = new Odometry(pLeftMotor, pRightMotor, pGyro);
+	wpi_assert(pOdometry);
+
+	pAccelerometer = new BuiltInAccelerometer();
+	wpi_assert(pAccelerometer);
+
+	pTraction = new TractionMonitor(TRACK_WIDTH_FEET);
+	wpi_assert(pTraction);
+
 	fStraightDriveDistance = 0.0;
 	fStraightDriveTime = 0.0;
 	fStraightDriveSpeed = 0.0;
 	fTurnAngle = 0.0;
 	fTurnTime = 0.0;
 
-	pCheezy = new CheesyLoop();
+	pCheezy = new CheesyLoop(CHEESY_INLINE);
 	pPixy = new PixyCam();
 
+	pProfile = new MotionProfile();
+	wpi_assert(pProfile);
+	SmartDashboard::PutNumber("Profile Accel", fProfileAccel);
+	SmartDashboard::PutNumber("Profile Jerk", fProfileJerk);
+	SmartDashboard::PutNumber("Turn Settle", fTurnSettle);
+	SmartDashboard::PutBoolean("Characterize Drive", false);
+
 	pTask = new std::thread(&Drivetrain::StartTask, this,
 			DRIVETRAIN_TASKNAME, DRIVETRAIN_PRIORITY);
 	wpi_assert(pTask);
@@ -122,23 +174,55 @@ Drivetrain::~Drivetrain()			//Destructor
 	delete pLeftMotor;
 	delete pRightMotor;
 	delete pGyro;
+	delete pProfile;
+	delete pOdometry;
+	delete pTraction;
+	delete pAccelerometer;
 }
 
 void Drivetrain::OnStateChange()
 {
+	CheesyTiming timing;
+
 	// do we need to do anything when the robot state changes?
 
+	pCheezy->GetTiming(timing);
+
+	if(timing.iUpdates > 0)
+	{
+		printf("cheesy %s, %d updates, iterate %0.1f us worst %0.1f us, latency %0.2f ms worst %0.2f ms\n",
+				pCheezy->IsInline() ? "inline" : "threaded", timing.iUpdates,
+				timing.fIterateTotal / timing.iUpdates * 1.0e6, timing.fIterateWorst * 1.0e6,
+				timing.fLatencyTotal / timing.iUpdates * 1.0e3, timing.fLatencyWorst * 1.0e3);
+		pCheezy->ResetTiming();
+	}
+
 	switch(localMessage.command)
 	{
 		case COMMAND_ROBOT_STATE_AUTONOMOUS:
 			pCheezy->bEnableServo = false;
 			bUnderServoControl = true;
 			bInAuto = true;
-			pLeftMotor->SetControlMode(CANTalon::kSpeed);
-			pRightMotor->SetControlMode(CANTalon::kSpeed);
+			bBlendOut = false;
+			bBlending = false;
+			bFollowingPath = false;
+			fHandoverSpeed = 0.0;
+
+			// the limits can be tuned from the dashboard without a new build
+
+			fMoveAccel = SmartDashboard::GetNumber("Profile Accel", fProfileAccel);
+			fMoveJerk = SmartDashboard::GetNumber("Profile Jerk", fProfileJerk);
+			fTurnSettleTime = SmartDashboard::GetNumber("Turn Settle", fTurnSettle);
+
+			pLeftMotor->SetControlMode(bStateSpaceDrive ? CANTalon::kPercentVbus : CANTalon::kSpeed);
+			pRightMotor->SetControlMode(bStateSpaceDrive ? CANTalon::kPercentVbus : CANTalon::kSpeed);
 			pLeftMotor->Set(0.0);
 			pRightMotor->Set(0.0);
 			pGyro->Zero();
+
+			// the field is measured from where the robot starts autonomous
+
+			pOdometry->Reset(0.0, 0.0, 0.0);
 			break;
 
 		case COMMAND_ROBOT_STATE_TEST:
@@ -149,6 +233,9 @@ void Drivetrain::OnStateChange()
 			pCheezy->bEnableServo = true;
 			bUnderServoControl = false;
 			bInAuto = false;
+			bBlendOut = false;
+			bBlending = false;
+			bFollowingPath = false;
 			pLeftMotor->SetControlMode(CANTalon::kPercentVbus);
 			pRightMotor->SetControlMode(CANTalon::kPercentVbus);
 			pLeftMotor->Set(0.0);
@@ -159,6 +246,26 @@ void Drivetrain::OnStateChange()
 
 void Drivetrain::Run() {
 
+	PublishSensors();
+
+	// a blended move left the wheels turning for the next one, do not let
+	// them run away if it never comes
+
+	if(bBlending && (pAutoTimer->Get() > fBlendStart + fBlendTimeout))
+	{
+		printf("no move after a blended move, stopping\n");
+		StopAutoMotors();
+	}
+
+	// same if the autonomous thread stops sending a path part way through
+
+	if(bFollowingPath && (pAutoTimer->Get() > fLastPathSample + fBlendTimeout))
+	{
+		printf("path samples stopped, stopping\n");
+		bFollowingPath = false;
+		StopAutoMotors();
+	}
+
 	switch(localMessage.command)
 	{
 	//Timing is set across this and gear intake side of macro
@@ -167,8 +274,7 @@ void Drivetrain::Run() {
 
 		    if(bUnderServoControl)
 			{
-				pLeftMotor->Set(0.33 * FULLSPEED_FROMTALONS);
-				pRightMotor->Set(-0.33 * FULLSPEED_FROMTALONS);
+				HoldWheelSpeeds(0.33, -0.33);
 				Wait(0.500);
 				// make darn sure it stops !
 				pLeftMotor->Set(0.0);
@@ -194,8 +300,9 @@ void Drivetrain::Run() {
 			break;
 
 		case COMMAND_DRIVETRAIN_DRIVE_TANK:  // move the robot in tank mode
-			pLeftMotor->Set(localMessage.params.tankDrive.left);
-			pRightMotor->Set(localMessage.params.tankDrive.right);
+			SetServoControl(false);
+			pLeftMotor->Set(PowerMonitor::GetInstance()->Compensate(localMessage.params.tankDrive.left, pLeftMotor, POWER_DRIVE_CURRENT, POWER_DRIVE_MOTORS));
+			pRightMotor->Set(PowerMonitor::GetInstance()->Compensate(localMessage.params.tankDrive.right, pRightMotor, POWER_DRIVE_CURRENT, POWER_DRIVE_MOTORS));
 			break;
 
 		case COMMAND_DRIVETRAIN_STOP:  // stop the robot
@@ -204,12 +311,21 @@ void Drivetrain::Run() {
 			break;
 
 		case COMMAND_DRIVETRAIN_DRIVE_CHEEZY:
+			// a replayed teleop recording drives in autonomous with the driver's voltages
+
+			SetServoControl(false);
 			RunCheezyDrive(true, localMessage.params.cheezyDrive.wheel,
 					localMessage.params.cheezyDrive.throttle, localMessage.params.cheezyDrive.bQuickturn);
 			break;
 
-		case COMMAND_SYSTEM_CONSTANTS:
-			fBatteryVoltage = localMessage.params.system.fBattery;
+		case COMMAND_ROBOT_STATE_TEST:
+			// only when asked, it drives the robot ten feet each way
+
+			if(SmartDashboard::GetBoolean("Characterize Drive", false))
+			{
+				Characterize();
+				ClearMessages();
+			}
 			break;
 
 		case COMMAND_DRIVETRAIN_AUTO_MOVE:
@@ -218,8 +334,7 @@ void Drivetrain::Run() {
 
 		    if(bUnderServoControl)
 			{
-				pLeftMotor->Set(localMessage.params.move.fLeft * FULLSPEED_FROMTALONS);
-				pRightMotor->Set(localMessage.params.move.fRight * FULLSPEED_FROMTALONS);
+				HoldWheelSpeeds(localMessage.params.move.fLeft, localMessage.params.move.fRight);
 			}
 			else
 			{
@@ -229,10 +344,13 @@ void Drivetrain::Run() {
 			break;
 
 		case COMMAND_DRIVETRAIN_AUTO_MMOVE:
+			SetServoControl(bInAuto);
 			bMeasuredMove = true;
 			bMeasuredMoveProximity = false;
 			bDrivingStraight = true;
 			bTurning = false;
+			fExitSpeed = localMessage.params.mmove.fExitSpeed;
+			bBlendOut = localMessage.params.mmove.bBlend;
 
 			StartStraightDrive(localMessage.params.mmove.fSpeed,
 	 				localMessage.params.mmove.fDistance,
@@ -242,25 +360,51 @@ void Drivetrain::Run() {
 			break;
 
 		case COMMAND_DRIVETRAIN_AUTO_PMOVE:
+			SetServoControl(bInAuto);
 			bMeasuredMove = false;
 			bMeasuredMoveProximity = true;
 			bDrivingStraight = true;
 			bTurning = false;
+			fExitSpeed = localMessage.params.pmove.fExitSpeed;
+			bBlendOut = localMessage.params.pmove.bBlend;
 
-			StartStraightDrive(localMessage.params.mmove.fSpeed,
-	 				localMessage.params.mmove.fDistance, localMessage.params.mmove.fTime);
+			StartStraightDrive(localMessage.params.pmove.fSpeed,
+	 				localMessage.params.pmove.fDistance, localMessage.params.pmove.fTime);
 
 	 		IterateStraightDrive();
 			break;
 
 		case COMMAND_DRIVETRAIN_TURN:
+			SetServoControl(bInAuto);
 			bDrivingStraight = false;
 			bTurning = true;
+			fExitSpeed = 0.0;
+			bBlendOut = localMessage.params.turn.bBlend;
 			StartTurn(localMessage.params.turn.fAngle, localMessage.params.turn.fTimeout);
 
 			IterateTurn();
 			break;
 
+		case COMMAND_DRIVETRAIN_AUTO_ARC:
+			SetServoControl(bInAuto);
+			bDrivingStraight = false;
+			bTurning = false;
+			fExitSpeed = localMessage.params.arc.fExitSpeed;
+			bBlendOut = localMessage.params.arc.bBlend;
+			StartArc(localMessage.params.arc.fSpeed, localMessage.params.arc.fRadius,
+					localMessage.params.arc.fAngle, localMessage.params.arc.fTime);
+
+			IterateArc();
+			break;
+
+		case COMMAND_DRIVETRAIN_AUTO_PATH:
+			SetServoControl(bInAuto);
+			bDrivingStraight = false;
+			bTurning = false;
+			bBlendOut = false;
+			FollowPath(localMessage.params.path);
+			break;
+
 		case COMMAND_DRIVETRAIN_PLED_ON:
 			pLed->Set(Relay::kForward);
 			printf("sup bro");
@@ -286,10 +430,38 @@ void Drivetrain::Run() {
 		SmartDashboard::PutNumber("ultrasonic", iRange);
 
 		SmartDashboard::PutNumber("Battery", fBatteryVoltage);
+
+		PowerState battery;
+
+		PowerMonitor::GetInstance()->GetState(battery);
+		SmartDashboard::PutNumber("Battery Resistance mOhm", battery.fResistance * 1000.0);
+		SmartDashboard::PutNumber("Battery Open Voltage", battery.fOpenVoltage);
+		SmartDashboard::PutNumber("Battery Current", battery.fCurrent);
 		SmartDashboard::PutNumber("angle", pGyro->GetAngle());
 		SmartDashboard::PutNumber("left encoder", -pLeftMotor->GetEncPosition() * METERS_PER_COUNT);
 		SmartDashboard::PutNumber("right encoder", pRightMotor->GetEncPosition() * METERS_PER_COUNT);
 
+		RobotPose pose;
+
+		Odometry::GetPose(pose);
+		SmartDashboard::PutNumber("Pose X", pose.fX);
+		SmartDashboard::PutNumber("Pose Y", pose.fY);
+		SmartDashboard::PutNumber("Pose Heading", pose.fHeading * 180.0 / M_PI);
+		SmartDashboard::PutBoolean("Slipping", pTraction->IsSlipping());
+		SmartDashboard::PutNumber("Slip Yaw Error", pTraction->GetYawError());
+		SmartDashboard::PutNumber("Slip Speed Error", pTraction->GetSpeedError());
+
+		CheesyTiming timing;
+
+		pCheezy->GetTiming(timing);
+
+		if(timing.iUpdates > 0)
+		{
+			SmartDashboard::PutNumber("Cheesy Iterate us", timing.fIterateTotal / timing.iUpdates * 1.0e6);
+			SmartDashboard::PutNumber("Cheesy Latency ms", timing.fLatencyTotal / timing.iUpdates * 1.0e3);
+			SmartDashboard::PutNumber("Cheesy Worst Latency ms", timing.fLatencyWorst * 1.0e3);
+		}
+
 		if(pPixiImageDetect->Get())
 		//if(pPixy->GetCentroid(fCentroid))
 		{
@@ -304,14 +476,69 @@ void Drivetrain::Run() {
 	}
 }
 
+void Drivetrain::PublishSensors(void)
+{
+	AutoSensors *pSensors = AutoSensors::GetInstance();
+
+	// called every pass of Run and every cycle of the auto drive loops so a
+	// WAIT_UNTIL sees the reading as soon as we do, and so the cheezy code
+	// knows what the battery is doing now
+
+	fBatteryVoltage = PowerMonitor::GetInstance()->PredictVoltage();
+
+	// the wheels against the gyro and accelerometer, forward positive
+
+	pTraction->Update(Timer::GetFPGATimestamp(), -pLeftMotor->GetEncVel() * TALON_FEET_PER_NATIVE,
+			pRightMotor->GetEncVel() * TALON_FEET_PER_NATIVE, pGyro->GetRate(),
+			fAccelForward * pAccelerometer->GetX());
+
+	// PMOVE pings by hand, between a ping and its echo there is no range
+
+	if(pUltrasonic->IsRangeValid())
+	{
+		pSensors->Publish(AUTO_SENSOR_RANGE, pUltrasonic->GetRangeInches());
+	}
+
+	pSensors->Publish(AUTO_SENSOR_HEADING_ERROR, fabs(pGyro->GetAngle() - fTurnAngle));
+	pSensors->Publish(AUTO_SENSOR_TARGET, pPixiImageDetect->Get() ? 1.0 : 0.0);
+}
+
+void Drivetrain::SetServoControl(bool bServo)
+{
+	// the Talons run their velocity loops for the measured moves in autonomous
+	// and take voltages from the driver, only switch when it changes, once the
+	// drive is characterized our own loops do it and the Talons stay on voltage
+
+	if(bServo == bUnderServoControl)
+	{
+		return;
+	}
+
+	bUnderServoControl = bServo;
+	pCheezy->bEnableServo = !bServo;
+
+	if(bServo && !bStateSpaceDrive)
+	{
+		pLeftMotor->SetControlMode(CANTalon::kSpeed);
+		pRightMotor->SetControlMode(CANTalon::kSpeed);
+	}
+	else
+	{
+		pLeftMotor->SetControlMode(CANTalon::kPercentVbus);
+		pRightMotor->SetControlMode(CANTalon::kPercentVbus);
+	}
+
+	pLeftMotor->Set(0.0);
+	pRightMotor->Set(0.0);
+}
+
 void Drivetrain::RunCheezyDrive(bool bEnabled, float fWheel, float fThrottle, bool bQuickturn)
 {
     struct DrivetrainGoal Goal;
     struct DrivetrainPosition Position;
     struct DrivetrainOutput Output;
     struct DrivetrainStatus Status;
-
-
+    double fSensorTime;
 
 	if(bQuickturn)
 	{
@@ -331,6 +558,7 @@ void Drivetrain::RunCheezyDrive(bool bEnabled, float fWheel, float fThrottle, bo
     Goal.left_goal = 0.0;
     Goal.right_goal = 0.0;
 
+    fSensorTime = CheesyLoop::Now();
     Position.left_encoder = -pLeftMotor->GetEncPosition() * METERS_PER_COUNT;
     Position.right_encoder = pRightMotor->GetEncPosition() * METERS_PER_COUNT;
     Position.gyro_angle = pGyro->GetAngle() * 3.141519 / 180.0;
@@ -343,15 +571,15 @@ void Drivetrain::RunCheezyDrive(bool bEnabled, float fWheel, float fThrottle, bo
     {
     	// if enabled and normal operation
 
-    	pCheezy->Update(Goal, Position, Output, Status, true);
-        pLeftMotor->Set(-Output.left_voltage / 12.0);
-        pRightMotor->Set(Output.right_voltage / 12.0);
+    	pCheezy->Update(Goal, Position, Output, Status, true, fSensorTime);
+        pLeftMotor->Set(PowerMonitor::GetInstance()->Compensate(-Output.left_voltage / POWER_NOMINAL_VOLTAGE, pLeftMotor, POWER_DRIVE_CURRENT, POWER_DRIVE_MOTORS));
+        pRightMotor->Set(PowerMonitor::GetInstance()->Compensate(Output.right_voltage / POWER_NOMINAL_VOLTAGE, pRightMotor, POWER_DRIVE_CURRENT, POWER_DRIVE_MOTORS));
     }
     else
     {
         // if the robot is not running
 
-    	pCheezy->Update(Goal, Position, Output, Status, false);
+    	pCheezy->Update(Goal, Position, Output, Status, false, fSensorTime);
     }
 }
 
@@ -16,6 +16,11 @@
 #include <pthread.h>
 
 #include "ADXRS453Z.h"
+#include "DriveCharacterize.h"
+#include "MotionProfile.h"
+#include "Odometry.h"
+#include "StateSpace.h"
+#include "TractionMonitor.h"
 
 /*
 Selected Device:0:Quad Encoder
@@ -68,9 +73,53 @@ const float TALON_IZONE	=			128;
 const float TALON_COUNTSPERREV =	512;	// from CTRE docs
 const float REVSPERFOOT = (3.14159 * 2.0 * 2.0 / 12.0);
 const double METERS_PER_COUNT = (REVSPERFOOT / (double)TALON_COUNTSPERREV);
-
-const float fMinimumTurnSpeed = 0.20;
+const float TALON_FEET_PER_NATIVE = (10.0 * REVSPERFOOT / TALON_COUNTSPERREV);	// feet/second per count/100ms
+
+const float TRACK_WIDTH_FEET = 2.0;		// middle of the left wheels to the middle of the right
+const float fArcHeadingGain = (1.0 / 30.0);	// same as StraightDriveLoop
+const float fSlipBackoff = 0.5;			// fraction of the profile speed a straight move drops to while slipping
+const float fSlipTimeout = 0.5;			// seconds of slipping before a move gives up
+const float fAccelForward = 1.0;		// roboRIO X axis points to the front, -1.0 if it is mounted the other way
+const float fTurnRate = 200.0;			// degrees/s, TURN cruises at this
+const float fTurnAccel = 600.0;			// degrees/s/s
+const float fTurnJerk = 4000.0;			// degrees/s/s/s
+const float fTurnLead = 0.08;			// seconds, acceleration feedforward, about the Talons' lag
+const float fTurnP = 6.0;				// degrees/s per degree behind the profile
+const float fTurnI = 1.0;				// degrees/s per degree second
+const float fTurnD = 0.3;				// degrees/s per degree/s of rate error
+const float fTurnIntegralLimit = 10.0;	// degree seconds
+const float fTurnTolerance = 1.0;		// degrees either way of the goal
+const float fTurnRateTolerance = 5.0;	// degrees/s, slow enough to call it stopped
+const float fTurnSettle = 0.1;			// seconds inside both tolerances, "Turn Settle" on the dashboard
+const float fBlendTimeout = 0.1;	// seconds we keep rolling after a blended move if nothing follows
+const float FULLSPEED_FEET = (FULLSPEED_FROMTALONS / 60.0 * REVSPERFOOT);	// feet/second at full speed
+const float fProfileAccel = 8.0;		// feet/s/s, default for MMOVE and PMOVE, "Profile Accel" on the dashboard
+const float fProfileJerk = 40.0;		// feet/s/s/s, "Profile Jerk" on the dashboard
+const float fProfileLead = 0.1;			// seconds, acceleration feedforward into the Talon velocity setpoint
+const float fProfilePositionGain = 2.0;	// feet/s of correction per foot behind the profile
+const float fProfileTolerance = 0.05;	// feet, close enough once the profile has finished
+const float fRamseteB = 0.186;			// 2.0 1/m/m in feet, how hard to pull back onto the path
+const float fRamseteZeta = 0.7;			// damping, 0 to 1
 const float fMaxUltrasonicDistance = (25.0/REVSPERFOOT*TALON_COUNTSPERREV);  //25 feet
+const float fUltrasonicBlindZone = 1.0;		// feet, closer than this the readings are junk and the encoders finish PMOVE
+const float fUltrasonicFilter = 0.3;		// of the way the PMOVE goal moves toward each new reading
+const float fUltrasonicJump = 1.0;			// feet, a reading that moves the goal further is a bad echo
+const int iUltrasonicMaxRejects = 5;		// bad echoes in a row before we believe it anyway
+const float fUltrasonicPingPeriod = 0.05;	// seconds between PMOVE's pings, no echo by the next one and it is lost
+
+const float fCharacterizeRamp = 0.5;		// volts/second, slow enough that acceleration is nothing
+const float fCharacterizeRampTime = 20.0;	// seconds, longest the ramp may go
+const float fCharacterizeStep = 6.0;		// volts for the step test
+const float fCharacterizeStepTime = 3.0;	// seconds
+const float fCharacterizeDistance = 10.0;	// feet, stop a test before we run out of room
+const float fCharacterizeRest = 1.0;		// seconds stopped between tests
+const double fCharacterizePeriod = 0.005;	// seconds between samples
+
+const bool STATESPACE_DRIVE = true;			// run the auto velocity loops on the roboRIO once the drive is characterized
+const float fStateSpacePeriod = 0.005;		// seconds, the auto loops call SetWheelSpeeds this often
+const float fStateSpaceSpeedError = 0.2;	// feet/s off the setpoint we care about as much as full voltage
+const float fStateSpaceModelError = 0.5;	// feet/s a period the model can be wrong by
+const float fStateSpaceSensorError = 0.1;	// feet/s of noise on the encoder velocity
 
 const int iIdealGearDistance = 10;    // 10" need to get this right (used for indicator on panel)
 const int iIdealGearDistanceError = 1;
@@ -96,11 +145,33 @@ private:
 	void OnStateChange();
 	void Run();
 	void RunCheezyDrive(bool, float, float, bool);
+	void SetServoControl(bool bServo);
 	void StartStraightDrive (float, float, float);
 	void IterateStraightDrive(void);
 	void StraightDriveLoop(float);
+	void UpdateApproachTarget(float fTravel);
+	float ApproachSpeed(float fRemaining);
 	void StartTurn(float, float);
 	void IterateTurn(void);
+	void StartArc(float, float, float, float);
+	void IterateArc(void);
+	void FollowPath(const PathParams &);
+	void Characterize(void);
+	bool CharacterizeTest(float fRamp, float fStep, float fTime, DriveSample *pLeft, DriveSample *pRight, int &iCount);
+	bool TestEnabled(void);
+	void ApplyGains(const DriveGains &rGains);
+	void SetWheelSpeeds(float fLeft, float fRight);
+	void HoldWheelSpeeds(float fLeft, float fRight);
+	void ResetWheelSpeeds(void);
+	void UpdatePathPose(void);
+	bool AutoEnabled(void);
+	void ZeroEncoders(void);
+	int GetLeftCounts(void);
+	int GetRightCounts(void);
+	void PublishSensors(void);
+	void EndSegment(AutoCompletion);
+	void StopAutoMotors(void);
+	AutoCompletion StoppedReason(void);
 
 	CANTalon* pLeftMotor;
 	CANTalon* pRightMotor;
@@ -114,6 +185,8 @@ private:
 	AnalogInput *pPixiImagePosition;
 
 	ADXRS453Z *pGyro;
+	BuiltInAccelerometer *pAccelerometer;
+	TractionMonitor *pTraction;
 	float fBatteryVoltage;
 	float fStraightDriveSpeed;
 	float fStraightDriveTime;
@@ -121,15 +194,55 @@ private:
 	float fTurnAngle;
 	float fTurnTime;
 	float fLastOffset;
+	float fExitSpeed;
+	float fArcSpeed;
+	float fArcRadius;
+	float fBlendStart;
+	float fHandoverSpeed;	// what the last move left the Talons running at
+	float fProfileStart;
+	float fApproachStandoff;	// feet from the object PMOVE stops at
+	float fApproachSpeed;		// feet/s PMOVE asked for last period
+	float fApproachTime;
+	float fApproachPingTime;
+	float fApproachPingTravel;	// counts we had gone when the last ping went out
+	bool bApproachListening;	// a ping is out and its echo not used yet
+	int iApproachRejects;
+	bool bApproachBlind;		// the ultrasonic is too close to trust, encoders only
+	float fMoveAccel;
+	float fMoveJerk;
+	float fTurnSettleTime;
+	float fTurnIntegral;
+	float fSettleStart;		// when the turn got inside tolerance, < 0 if it is not
+	float fPoseX;			// feet, where odometry puts us on the path
+	float fPoseY;
+	float fPoseHeading;		// radians, counter clockwise like the path
+	float fPathStartX;
+	float fPathStartY;
+	float fPathStartHeading;
+	RobotPose pathOrigin;	// odometry when the path started
+	float fLastPathSample;
+	int iStartPosition;		// right encoder counts when the move started
+	int iStartPositionLeft;
 	bool bUnderServoControl;
 	bool bMeasuredMove;
 	bool bMeasuredMoveProximity;
 	bool bDrivingStraight;
 	bool bTurning;
 	bool bInAuto;
+	bool bBlendOut;			// the move we are doing hands over to another one
+	bool bBlending;			// the last move handed over and we are waiting for the next
+	bool bFollowingPath;	// PATH samples are arriving every control period
 
 	CheesyLoop *pCheezy;
 	PixyCam *pPixy;
+	MotionProfile *pProfile;
+	Odometry *pOdometry;
+
+	bool bStateSpaceDrive;	// the velocity loops below drive the Talons in volts
+	DriveGains driveGains;
+	StateSpaceLoop<1, 1, 1> leftVelocity;
+	StateSpaceLoop<1, 1, 1> rightVelocity;
+	double fWheelSpeedTime;	// when SetWheelSpeeds last ran
 };
 
 #endif			//DRIVETRAIN_H
@@ -24,6 +24,7 @@
 #include "Drivetrain.h"
 #include "CheesyDrive.h"
 #include "PixyCam.h"
+#include "PowerMonitor.h"
 #include "RobotParams.h"
 
 
@@ -32,19 +33,25 @@ using namespace std;
 
 void Drivetrain::StartStraightDrive (float speed, float distance, float time)
 {
+	float fEntrySpeed = 0.0;
+
 	// start a timer so we do not spend forever in this loop
 
 	pAutoTimer->Reset();
 	pAutoTimer->Start();
 
-	// set relative encoder position, we'll measure from zero
+	// measure from where the encoders are now, if we are still rolling from
+	// the last move we start at the speed it handed over
 
-	while(pRightMotor->GetEncPosition() && bInAuto)
+	if(bBlending)
 	{
-		pRightMotor->SetEncPosition(0);
-		Wait(.005);
+		fEntrySpeed = fabs(fHandoverSpeed) * FULLSPEED_FEET;
 	}
 
+	ZeroEncoders();
+	pTraction->Reset();
+	bBlending = false;
+
 	fTurnAngle = 0.0;
 	pGyro->Zero();
 
@@ -72,45 +79,158 @@ void Drivetrain::StartStraightDrive (float speed, float distance, float time)
 		printf("fStraightDriveDistance in feet %f and counts %d \n", fStraightDriveDistance,
 				(int)(fStraightDriveDistance/REVSPERFOOT*TALON_COUNTSPERREV));
 		fStraightDriveDistance = fStraightDriveDistance/REVSPERFOOT*TALON_COUNTSPERREV;
+
+		// that first ping is only where we start, IterateStraightDrive keeps
+		// moving the goal as the readings come in
+
+		fApproachStandoff = distance;
+		fApproachSpeed = fEntrySpeed;
+		fApproachTime = pAutoTimer->Get();
+		fApproachPingTime = fApproachTime - fUltrasonicPingPeriod;
+		fApproachPingTravel = 0.0;
+		bApproachListening = false;
+		iApproachRejects = 0;
+		bApproachBlind = false;
 	}
 	else
 	{
 		fStraightDriveDistance = 0.0;
 	}
 
-	// attempt to adjust for stop time
+	// speed up and slow down along a jerk limited profile instead of jumping to
+	// full speed and stopping dead, we slow to the exit speed if we blend out.
+	// PMOVE's goal keeps moving so it works its speed out as it goes instead
+
+	if(bMeasuredMove)
+	{
+		pProfile->Plan(fabs(fStraightDriveDistance) / TALON_COUNTSPERREV * REVSPERFOOT, fEntrySpeed,
+				fabs(speed) * FULLSPEED_FEET, bBlendOut ? fabs(fExitSpeed) * FULLSPEED_FEET : 0.0,
+				fMoveAccel, fMoveJerk);
+		fProfileStart = pAutoTimer->Get();
+	}
+}
+
+void Drivetrain::ZeroEncoders(void)
+{
+	// the Talons keep counting, we just remember where they were, writing
+	// zero to them means waiting on the CAN bus until they say they did it
+
+	iStartPosition = pRightMotor->GetEncPosition();
+	iStartPositionLeft = pLeftMotor->GetEncPosition();
+}
+
+int Drivetrain::GetLeftCounts(void)
+{
+	// counts since ZeroEncoders, positive going forward
+
+	return(-(pLeftMotor->GetEncPosition() - iStartPositionLeft));
+}
+
+int Drivetrain::GetRightCounts(void)
+{
+	return(pRightMotor->GetEncPosition() - iStartPosition);
+}
+
+bool Drivetrain::AutoEnabled(void)
+{
+	// our message loop is blocked while we drive, so ask the driver station directly
+
+	return(bInAuto && DriverStation::GetInstance().IsEnabled() &&
+			DriverStation::GetInstance().IsAutonomous());
+}
+
+AutoCompletion Drivetrain::StoppedReason(void)
+{
+	// call when a move ended before reaching its goal
 
-	//if(fStraightDriveDistance > 0.0)
-	//{
-	//	fStraightDriveDistance -= (speed / FULLSPEED_FROMTALONS * 0.25);
-	//}
-	//else if(fStraightDriveDistance < 0.0)
-	//{
-	//	fStraightDriveDistance += (speed / FULLSPEED_FROMTALONS * 0.25);
-	//}
+	return(AutoEnabled() ? AUTO_COMPLETE_TIMEOUT : AUTO_COMPLETE_DISABLED);
 }
 
 void Drivetrain::IterateStraightDrive(void)
 {
+	AutoCompletion eReason = AUTO_COMPLETE_DONE;
+	MotionSample sample;
+	float fTravel;
+	float fProfileTime;
+	float fSpeed;
+	float fRemaining;
+
 	if(bMeasuredMove || bMeasuredMoveProximity)
 	{
 		while(true)
 		{
-			if ((pAutoTimer->Get() < fStraightDriveTime) && bInAuto)
+			if ((pAutoTimer->Get() < fStraightDriveTime) && AutoEnabled())
 			{
 				//SmartDashboard::PutNumber("travelenc", pRightOneMotor->GetEncPosition());
 				//SmartDashboard::PutNumber("distenc", fStraightDriveDistance * (TALON_COUNTSPERREV * REVSPERFOOT));
 				//SmartDashboard::PutNumber("velocity Right", pRightOneMotor->GetSpeed());
 				//SmartDashboard::PutNumber("velocity Left", pLeftOneMotor->GetSpeed());
 
-				if((float)abs(pRightMotor->GetEncPosition()) < fabs(fStraightDriveDistance))
+				PublishSensors();
+				fTravel = fabs((GetLeftCounts() + GetRightCounts()) / 2.0);
+				fProfileTime = pAutoTimer->Get() - fProfileStart;
+
+				// the encoders are not measuring the robot, stopping on them
+				// would stop in the wrong place
+
+				if(pTraction->GetSlipTime() > fSlipTimeout)
 				{
-					StraightDriveLoop(fStraightDriveSpeed);
+					printf("slipping, gave up after %d of %d counts\n", (int)fTravel, (int)fStraightDriveDistance);
+					eReason = AUTO_COMPLETE_SLIP;
+					break;
+				}
+
+				// an approach that hit the peg or the wall is as close as it
+				// is going to get, pushing on until the timeout gains nothing
+
+				if(bMeasuredMoveProximity && pTraction->HadImpact())
+				{
+					printf("impact after %d of %d counts\n", (int)fTravel, (int)fStraightDriveDistance);
+					eReason = AUTO_COMPLETE_IMPACT;
+					break;
+				}
+
+				if(bMeasuredMoveProximity)
+				{
+					UpdateApproachTarget(fTravel);
+				}
+
+				fRemaining = (fStraightDriveDistance - fTravel) / TALON_COUNTSPERREV * REVSPERFOOT;
+
+				if(bMeasuredMoveProximity ? (fRemaining > fProfileTolerance) :
+						((fTravel < fabs(fStraightDriveDistance)) &&
+						!(pProfile->IsDone(fProfileTime) && (fabs(fStraightDriveDistance) - fTravel) /
+								TALON_COUNTSPERREV * REVSPERFOOT < fProfileTolerance)))
+				{
+					if(bMeasuredMoveProximity)
+					{
+						fSpeed = ApproachSpeed(fRemaining) / FULLSPEED_FEET;
+					}
+					else
+					{
+						// follow the profile, lead the Talon by the acceleration we want
+						// and pull back onto the profile if we fall behind or get ahead
+
+						pProfile->Sample(fProfileTime, sample);
+						fSpeed = (sample.fVelocity + fProfileLead * sample.fAccel +
+								fProfilePositionGain * (sample.fPosition - fTravel / TALON_COUNTSPERREV * REVSPERFOOT)) /
+								FULLSPEED_FEET;
+					}
+
+					fSpeed = std::min(std::max(fSpeed, 0.0f), 1.0f);
+
+					if(pTraction->IsSlipping())
+					{
+						// ease off so the wheels can bite again
+						fSpeed *= fSlipBackoff;
+					}
+
+					StraightDriveLoop((fStraightDriveSpeed < 0.0) ? -fSpeed : fSpeed);
 					Wait(.005);
 				}
 				else
 				{
-					printf("reached limit traveled %d , needed %d (%d) \n", pRightMotor->GetEncPosition(),
+					printf("reached limit traveled %d , needed %d (%d) \n", (int)fTravel,
 							(int)(fStraightDriveDistance),
 							(int)(fStraightDriveDistance * (TALON_COUNTSPERREV * REVSPERFOOT)));
 
@@ -120,35 +240,135 @@ void Drivetrain::IterateStraightDrive(void)
 			else
 			{
 				//printf("not auto or timed out \n");
+				eReason = StoppedReason();
 				break;
 			}
 		}
 	}
 	else
 	{
-		if ((pAutoTimer->Get() < fStraightDriveTime) && bInAuto)
+		if ((pAutoTimer->Get() < fStraightDriveTime) && AutoEnabled())
 		{
 			StraightDriveLoop(fStraightDriveSpeed);
 		}
 		else
 		{
+			eReason = AutoEnabled() ? AUTO_COMPLETE_DONE : AUTO_COMPLETE_DISABLED;
 			bDrivingStraight = false;
 			pLeftMotor->Set(0.0);
 			pRightMotor->Set(0.0);
 		}
 	}
 
+	EndSegment(eReason);
 	bDrivingStraight = false;
+
+	if(bMeasuredMoveProximity)
+	{
+		pUltrasonic->SetAutomaticMode(true);
+	}
+
 	bMeasuredMoveProximity = false;
-	pLeftMotor->Set(0.0);
-	pRightMotor->Set(0.0);
-	pLeftMotor->ClearError();
-	pRightMotor->ClearError();
-	pLeftMotor->StopMotor();
-	pRightMotor->StopMotor();
 	pLed->Set(Relay::kReverse);
 
-	SendCommandResponse(COMMAND_AUTONOMOUS_RESPONSE_OK);
+	SendCommandResponse(COMMAND_AUTONOMOUS_RESPONSE_OK, eReason);
+}
+
+void Drivetrain::UpdateApproachTarget(float fTravel)
+{
+	float fNow = pAutoTimer->Get();
+	float fRange = 0.0;
+	float fPingTravel = 0.0;
+	bool bFresh = false;
+	float fTarget;
+
+	// once we are in the ultrasonic's blind zone the encoders finish off from
+	// the last goal it gave us
+
+	if(bApproachBlind)
+	{
+		return;
+	}
+
+	// we ping it ourselves, so a valid range is the echo of our last ping and
+	// is where we were when that went out, not where we are now.  It stays
+	// valid until the next ping, listening makes sure we use it only once
+
+	if(bApproachListening && pUltrasonic->IsRangeValid())
+	{
+		fRange = pUltrasonic->GetRangeInches() / 12.0;
+		fPingTravel = fApproachPingTravel;
+		bApproachListening = false;
+		bFresh = true;
+	}
+
+	if((fNow - fApproachPingTime) >= fUltrasonicPingPeriod)
+	{
+		pUltrasonic->Ping();
+		fApproachPingTime = fNow;
+		fApproachPingTravel = fTravel;
+		bApproachListening = true;
+	}
+
+	if(!bFresh)
+	{
+		return;
+	}
+
+	if(fRange < fUltrasonicBlindZone)
+	{
+		printf("ultrasonic blind at %0.2f ft, %0.2f ft to go on the encoders\n", fRange,
+				(fStraightDriveDistance - fTravel) / TALON_COUNTSPERREV * REVSPERFOOT);
+		bApproachBlind = true;
+		return;
+	}
+
+	// the goal in encoder counts from the start, it should stay put while we
+	// drive so smoothing it costs no lag, and an echo off something else shows
+	// up as a jump
+
+	fTarget = fPingTravel + (fRange - fApproachStandoff) / REVSPERFOOT * TALON_COUNTSPERREV;
+
+	if((fTarget - fPingTravel) > fMaxUltrasonicDistance)
+	{
+		return;
+	}
+
+	if(fabs(fTarget - fStraightDriveDistance) / TALON_COUNTSPERREV * REVSPERFOOT > fUltrasonicJump)
+	{
+		if(iApproachRejects < iUltrasonicMaxRejects)
+		{
+			iApproachRejects++;
+			return;
+		}
+
+		// it keeps saying so, the goal we had was the bad one
+
+		fStraightDriveDistance = fTarget;
+	}
+	else
+	{
+		fStraightDriveDistance += fUltrasonicFilter * (fTarget - fStraightDriveDistance);
+	}
+
+	iApproachRejects = 0;
+}
+
+float Drivetrain::ApproachSpeed(float fRemaining)
+{
+	float fNow = pAutoTimer->Get();
+	float fEndSpeed = bBlendOut ? fabs(fExitSpeed) * FULLSPEED_FEET : 0.0;
+	float fStopping;
+
+	// as fast as we can still stop at the standoff from, wherever the
+	// ultrasonic has moved it to, speeding up no faster than a profile would
+
+	fStopping = sqrt(fEndSpeed * fEndSpeed + 2.0 * fMoveAccel * std::max(fRemaining, 0.0f));
+	fApproachSpeed = std::min(std::min(fApproachSpeed + fMoveAccel * (fNow - fApproachTime),
+			fabs(fStraightDriveSpeed) * FULLSPEED_FEET), fStopping);
+	fApproachTime = fNow;
+
+	return(fApproachSpeed);
 }
 
 void Drivetrain::StraightDriveLoop(float speed)
@@ -194,8 +414,7 @@ void Drivetrain::StraightDriveLoop(float speed)
 		//}
 	}
 
-	pLeftMotor->Set(-(speed - offset) * FULLSPEED_FROMTALONS* fBatteryVoltage / 12.0);
-	pRightMotor->Set((speed + offset) * FULLSPEED_FROMTALONS* fBatteryVoltage / 12.0);
+	SetWheelSpeeds(-(speed - offset), speed + offset);
 }
 
 
@@ -207,55 +426,432 @@ void Drivetrain::StartTurn(float angle, float time)
 	fTurnAngle = angle;
 	fTurnTime = time;
 	pGyro->Zero();
+	bBlending = false;
+	pTraction->Reset();
+
+	// same jerk limited profile as the straight moves, in degrees
+
+	pProfile->Plan(fabs(angle), 0.0, fTurnRate, 0.0, fTurnAccel, fTurnJerk);
+	fProfileStart = pAutoTimer->Get();
+	fTurnIntegral = 0.0;
+	fSettleStart = -1.0;
 }
 
 void Drivetrain::IterateTurn(void)
 {
+	MotionSample sample;
+	float fNow;
+	float fLast;
+	float fDirection = (fTurnAngle < 0.0) ? -1.0 : 1.0;
 	float fCurrentAngle;
-	float fCurrentError;
+	float fCurrentRate;
+	float fProfileError;
+	float fYawRate;
 	float fNextMotor;
+	AutoCompletion eReason = AUTO_COMPLETE_DONE;
 
 	if(bTurning)
 	{
+		fLast = pAutoTimer->Get();
+
 		while(true)
 		{
+			PublishSensors();
+			fNow = pAutoTimer->Get();
 			fCurrentAngle = pGyro->GetAngle();
-			fCurrentError = fCurrentAngle - fTurnAngle;
-			fNextMotor = fCurrentError/180.0;
+			fCurrentRate = pGyro->GetRate();
 
-			if((fNextMotor > 0.0) && (fNextMotor < fMinimumTurnSpeed))
+			// we are done when we have stayed at the angle, not when we pass it
+
+			if((fabs(fCurrentAngle - fTurnAngle) < fTurnTolerance) && (fabs(fCurrentRate) < fTurnRateTolerance))
 			{
-				fNextMotor = fMinimumTurnSpeed;
+				if(fSettleStart < 0.0)
+				{
+					fSettleStart = fNow;
+				}
+				else if(fNow - fSettleStart >= fTurnSettleTime)
+				{
+					break;
+				}
 			}
-			else if((fNextMotor < 0.0) && (fNextMotor > -fMinimumTurnSpeed))
+			else
 			{
-				fNextMotor = -fMinimumTurnSpeed;
+				fSettleStart = -1.0;
 			}
 
-			if(((fCurrentError >= 1.0) || (fCurrentError <= -1.0)) && (pAutoTimer->Get() < fTurnTime) && bInAuto)
+			if((fNow >= fTurnTime) || !AutoEnabled())
 			{
-				pLeftMotor->Set(fNextMotor * FULLSPEED_FROMTALONS * fBatteryVoltage / 12.0);
-				pRightMotor->Set(fNextMotor * FULLSPEED_FROMTALONS * fBatteryVoltage / 12.0);
+				eReason = StoppedReason();
+				break;
 			}
-			else
+
+			if(pTraction->GetSlipTime() > fSlipTimeout)
 			{
+				eReason = AUTO_COMPLETE_SLIP;
 				break;
 			}
 
+			// follow the profile, feedforward does most of the work and the PID
+			// takes up what the robot does differently, all in degrees clockwise
+
+			pProfile->Sample(fNow - fProfileStart, sample);
+			fProfileError = fDirection * sample.fPosition - fCurrentAngle;
+			fTurnIntegral = std::min(std::max(fTurnIntegral + fProfileError * (fNow - fLast),
+					-fTurnIntegralLimit), fTurnIntegralLimit);
+			fLast = fNow;
+
+			fYawRate = fDirection * (sample.fVelocity + fTurnLead * sample.fAccel) + fTurnP * fProfileError +
+					fTurnI * fTurnIntegral + fTurnD * (fDirection * sample.fVelocity - fCurrentRate);
+
+			// each side goes round half the track width, both motors the same
+			// way spins us, negative is clockwise
+
+			fNextMotor = -fYawRate * M_PI / 180.0 * TRACK_WIDTH_FEET / 2.0 / FULLSPEED_FEET;
+			fNextMotor = std::min(std::max(fNextMotor, -1.0f), 1.0f);
+
+			SetWheelSpeeds(fNextMotor, fNextMotor);
+
 			Wait(0.005);
 		}
 
-		pLeftMotor->Set(0.0);
-		pRightMotor->Set(0.0);
-		pLeftMotor->ClearError();
-		pRightMotor->ClearError();
-		pLeftMotor->StopMotor();
-		pRightMotor->StopMotor();
+		EndSegment(eReason);
 		bTurning = false;
-		SendCommandResponse(COMMAND_AUTONOMOUS_RESPONSE_OK);
+		SendCommandResponse(COMMAND_AUTONOMOUS_RESPONSE_OK, eReason);
+	}
+}
+
+void Drivetrain::StartArc(float speed, float radius, float angle, float time)
+{
+	pAutoTimer->Reset();
+	pAutoTimer->Start();
+
+	ZeroEncoders();
+	pTraction->Reset();
+
+	// the heading we end up on is held by StraightDriveLoop if we blend out
+
+	fArcSpeed = speed;
+	fArcRadius = radius;
+	fTurnAngle = angle;
+	fTurnTime = time;
+	pGyro->Zero();
+	bBlending = false;
+}
+
+void Drivetrain::IterateArc(void)
+{
+	AutoCompletion eReason = AUTO_COMPLETE_DONE;
+	float fTravel;
+	float fExpectedAngle;
+	float fCurrentAngle;
+	float fYawSpeed;
+	float fOffset;
+	float fLeft;
+	float fRight;
+	float fLargest;
+
+	// turning this way makes the outside wheel go this much faster than the middle
+	// of the robot and the inside wheel this much slower, whichever way we drive
+
+	fYawSpeed = fabs(fArcSpeed) * TRACK_WIDTH_FEET / (2.0 * fArcRadius);
+
+	if(fTurnAngle < 0.0)
+	{
+		fYawSpeed = -fYawSpeed;
+	}
+
+	while(true)
+	{
+		PublishSensors();
+		fCurrentAngle = pGyro->GetAngle();
+
+		if(fabs(fCurrentAngle) >= fabs(fTurnAngle))
+		{
+			break;
+		}
+		else if((pAutoTimer->Get() >= fTurnTime) || !AutoEnabled())
+		{
+			eReason = StoppedReason();
+			break;
+		}
+		else if(pTraction->GetSlipTime() > fSlipTimeout)
+		{
+			eReason = AUTO_COMPLETE_SLIP;
+			break;
+		}
+
+		// how far round the arc we should be for the distance we have gone,
+		// steer back onto it if the gyro disagrees
+
+		fTravel = fabs((GetLeftCounts() + GetRightCounts()) / 2.0) / TALON_COUNTSPERREV * REVSPERFOOT;
+		fExpectedAngle = fTravel / fArcRadius * 180.0 / 3.14159;
+
+		if(fTurnAngle < 0.0)
+		{
+			fExpectedAngle = -fExpectedAngle;
+		}
+
+		fOffset = (fCurrentAngle - fExpectedAngle) * fArcHeadingGain;
+		fLeft = fArcSpeed + fYawSpeed - fOffset;
+		fRight = fArcSpeed - fYawSpeed + fOffset;
+
+		// keep the ratio if the outside wheel would need more than full speed
+
+		fLargest = std::max(fabs(fLeft), fabs(fRight));
+
+		if(fLargest > 1.0)
+		{
+			fLeft /= fLargest;
+			fRight /= fLargest;
+		}
+
+		SetWheelSpeeds(-fLeft, fRight);
+		Wait(0.005);
 	}
+
+	// hold the new heading if we hand over to a straight move
+
+	bMeasuredMove = true;
+	bMeasuredMoveProximity = false;
+	EndSegment(eReason);
+	SendCommandResponse(COMMAND_AUTONOMOUS_RESPONSE_OK, eReason);
 }
 
+void Drivetrain::FollowPath(const PathParams &rSample)
+{
+	float fErrorX;
+	float fErrorY;
+	float fErrorAlong;
+	float fErrorAcross;
+	float fErrorHeading;
+	float fAngularVelocity;
+	float fGain;
+	float fSinc;
+	float fVelocity;
+	float fTurnRate;
+	float fLeft;
+	float fRight;
+
+	// the first sample is where the robot is, the path is drawn from there
+
+	if(rSample.bFirst || !bFollowingPath)
+	{
+		pAutoTimer->Reset();
+		pAutoTimer->Start();
+		pGyro->Zero();
+
+		Odometry::GetPose(pathOrigin);
+		fPathStartX = rSample.fX;
+		fPathStartY = rSample.fY;
+		fPathStartHeading = rSample.fHeading;
+		bFollowingPath = true;
+		bBlending = false;
+	}
+
+	UpdatePathPose();
+
+	fLastPathSample = pAutoTimer->Get();
+
+	if(!AutoEnabled())
+	{
+		bFollowingPath = false;
+		StopAutoMotors();
+
+		if(rSample.bLast)
+		{
+			SendCommandResponse(COMMAND_AUTONOMOUS_RESPONSE_OK, AUTO_COMPLETE_DISABLED);
+		}
+
+		return;
+	}
+
+	// RAMSETE, turn the error into the robot's frame and steer so it dies away
+	// like a damped spring whatever speed the path is going
+
+	fErrorX = rSample.fX - fPoseX;
+	fErrorY = rSample.fY - fPoseY;
+	fErrorAlong = cos(fPoseHeading) * fErrorX + sin(fPoseHeading) * fErrorY;
+	fErrorAcross = -sin(fPoseHeading) * fErrorX + cos(fPoseHeading) * fErrorY;
+	fErrorHeading = remainder(rSample.fHeading - fPoseHeading, 2.0 * M_PI);
+
+	fAngularVelocity = rSample.fVelocity * rSample.fCurvature;
+	fGain = 2.0 * fRamseteZeta * sqrt(fAngularVelocity * fAngularVelocity +
+			fRamseteB * rSample.fVelocity * rSample.fVelocity);
+	fSinc = (fabs(fErrorHeading) < 1.0e-4) ? 1.0 : sin(fErrorHeading) / fErrorHeading;
+
+	fVelocity = rSample.fVelocity * cos(fErrorHeading) + fGain * fErrorAlong;
+	fTurnRate = fAngularVelocity + fGain * fErrorHeading + fRamseteB * rSample.fVelocity * fSinc * fErrorAcross;
 
+	// counter clockwise speeds up the right side
 
+	fLeft = (fVelocity - fTurnRate * TRACK_WIDTH_FEET / 2.0) / FULLSPEED_FEET;
+	fRight = (fVelocity + fTurnRate * TRACK_WIDTH_FEET / 2.0) / FULLSPEED_FEET;
 
+	SetWheelSpeeds(-fLeft, fRight);
+
+	if(rSample.bLast)
+	{
+		printf("path done %0.2f ft along %0.2f ft across %0.1f deg off\n", fErrorAlong, fErrorAcross,
+				fErrorHeading * 180.0 / M_PI);
+		bFollowingPath = false;
+		EndSegment(AUTO_COMPLETE_DONE);
+		SendCommandResponse(COMMAND_AUTONOMOUS_RESPONSE_OK, AUTO_COMPLETE_DONE);
+	}
+}
+
+void Drivetrain::UpdatePathPose(void)
+{
+	RobotPose pose;
+	float fTurned;
+	float fX;
+	float fY;
+
+	// odometry measures from where autonomous started, turn and shift that so
+	// the robot was at the first sample when the path started
+
+	Odometry::GetPose(pose);
+	fTurned = fPathStartHeading - pathOrigin.fHeading;
+	fX = pose.fX - pathOrigin.fX;
+	fY = pose.fY - pathOrigin.fY;
+
+	fPoseX = fPathStartX + fX * cos(fTurned) - fY * sin(fTurned);
+	fPoseY = fPathStartY + fX * sin(fTurned) + fY * cos(fTurned);
+	fPoseHeading = pose.fHeading + fTurned;
+}
+
+void Drivetrain::EndSegment(AutoCompletion eReason)
+{
+	if(bBlendOut && (eReason == AUTO_COMPLETE_DONE))
+	{
+		// the next move is on its way, leave the Talons running at the hand over
+		// speed instead of braking to a stop and starting over
+
+		if(fExitSpeed != 0.0)
+		{
+			HoldWheelSpeeds(-fExitSpeed, fExitSpeed);
+		}
+		else
+		{
+			pLeftMotor->Set(0.0);
+			pRightMotor->Set(0.0);
+		}
+
+		fHandoverSpeed = fExitSpeed;
+		bBlending = true;
+		fBlendStart = pAutoTimer->Get();
+	}
+	else
+	{
+		StopAutoMotors();
+	}
+
+	bBlendOut = false;
+}
+
+void Drivetrain::SetWheelSpeeds(float fLeft, float fRight)
+{
+	Matrix<1, 1> y;
+	Matrix<1, 1> r;
+	float fLeftVolts;
+	float fRightVolts;
+	double fNow;
+
+	// fractions of full speed the way the Talons count them, the left side runs backwards
+
+	if(!bStateSpaceDrive)
+	{
+		pLeftMotor->Set(fLeft * FULLSPEED_FROMTALONS);
+		pRightMotor->Set(fRight * FULLSPEED_FROMTALONS);
+		return;
+	}
+
+	// after a gap between moves the estimates are stale, start again from the wheels
+
+	fNow = Timer::GetFPGATimestamp();
+
+	if((fNow - fWheelSpeedTime) > 4.0 * fStateSpacePeriod)
+	{
+		ResetWheelSpeeds();
+	}
+
+	fWheelSpeedTime = fNow;
+
+	// the loops only know kV and kA, kS goes on top in the direction we want to go
+
+	y(0, 0) = pLeftMotor->GetEncVel() * TALON_FEET_PER_NATIVE;
+	r(0, 0) = fLeft * FULLSPEED_FEET;
+	fLeftVolts = leftVelocity.Update(y, r)(0, 0);
+
+	if(r(0, 0) != 0.0)
+	{
+		fLeftVolts += (r(0, 0) > 0.0) ? driveGains.leftModel.fKs : -driveGains.leftModel.fKs;
+	}
+
+	y(0, 0) = pRightMotor->GetEncVel() * TALON_FEET_PER_NATIVE;
+	r(0, 0) = fRight * FULLSPEED_FEET;
+	fRightVolts = rightVelocity.Update(y, r)(0, 0);
+
+	if(r(0, 0) != 0.0)
+	{
+		fRightVolts += (r(0, 0) > 0.0) ? driveGains.rightModel.fKs : -driveGains.rightModel.fKs;
+	}
+
+	pLeftMotor->Set(PowerMonitor::GetInstance()->Compensate(fLeftVolts / POWER_NOMINAL_VOLTAGE, pLeftMotor, POWER_DRIVE_CURRENT, POWER_DRIVE_MOTORS));
+	pRightMotor->Set(PowerMonitor::GetInstance()->Compensate(fRightVolts / POWER_NOMINAL_VOLTAGE, pRightMotor, POWER_DRIVE_CURRENT, POWER_DRIVE_MOTORS));
+}
+
+void Drivetrain::HoldWheelSpeeds(float fLeft, float fRight)
+{
+	float fLeftVolts;
+	float fRightVolts;
+
+	if(!bStateSpaceDrive)
+	{
+		SetWheelSpeeds(fLeft, fRight);
+		return;
+	}
+
+	// nobody is going to call us again to close the loop, one pass of it held
+	// until the next move would wind the output up to the rail, so send what
+	// the model says the speed takes and nothing for the error
+
+	fLeftVolts = fLeft * FULLSPEED_FEET * driveGains.leftModel.fKv;
+	fRightVolts = fRight * FULLSPEED_FEET * driveGains.rightModel.fKv;
+
+	if(fLeft != 0.0)
+	{
+		fLeftVolts += (fLeft > 0.0) ? driveGains.leftModel.fKs : -driveGains.leftModel.fKs;
+	}
+
+	if(fRight != 0.0)
+	{
+		fRightVolts += (fRight > 0.0) ? driveGains.rightModel.fKs : -driveGains.rightModel.fKs;
+	}
+
+	pLeftMotor->Set(PowerMonitor::GetInstance()->Compensate(fLeftVolts / POWER_NOMINAL_VOLTAGE, pLeftMotor, POWER_DRIVE_CURRENT, POWER_DRIVE_MOTORS));
+	pRightMotor->Set(PowerMonitor::GetInstance()->Compensate(fRightVolts / POWER_NOMINAL_VOLTAGE, pRightMotor, POWER_DRIVE_CURRENT, POWER_DRIVE_MOTORS));
+}
+
+void Drivetrain::ResetWheelSpeeds(void)
+{
+	Matrix<1, 1> x;
+
+	// start the estimates where the wheels are, they may still be rolling
+
+	x(0, 0) = pLeftMotor->GetEncVel() * TALON_FEET_PER_NATIVE;
+	leftVelocity.Reset(x);
+	x(0, 0) = pRightMotor->GetEncVel() * TALON_FEET_PER_NATIVE;
+	rightVelocity.Reset(x);
+}
+
+void Drivetrain::StopAutoMotors(void)
+{
+	pLeftMotor->Set(0.0);
+	pRightMotor->Set(0.0);
+	pLeftMotor->ClearError();
+	pRightMotor->ClearError();
+	pLeftMotor->StopMotor();
+	pRightMotor->StopMotor();
+	fHandoverSpeed = 0.0;
+	bBlending = false;
+}
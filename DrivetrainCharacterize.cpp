@@ -0,0 +1,202 @@
+/** \file
+ * Drivetrain characterization, run from test mode.
+ *
+ * Tick "Characterize Drive" on the dashboard and enable in test mode with the
+ * robot on the carpet and ten feet clear in front and behind.  The robot ramps
+ * the voltage up slowly forward then back, then steps it forward then back,
+ * logging what the Talons put out and how fast the wheels went every 5 ms.
+ * Each side gets its own fit and its own PIDF, they go into the Talons right
+ * away and into DRIVECHARACTERIZE_FILEPATH for the next time the robot starts.
+ *
+ * Disabling at any point stops the motors and throws the run away.
+ */
+
+#include <math.h>
+#include <time.h>
+
+#include "Drivetrain.h"
+#include "PowerMonitor.h"
+#include "RobotParams.h"
+#include "Timespec.h"
+
+static bool DesignVelocityLoop(const DriveModel &rModel, StateSpaceLoop<1, 1, 1> &rLoop)
+{
+	Matrix<1, 1> A;
+	Matrix<1, 1> B;
+	Matrix<1, 1> C;
+	DiscretePlant<1, 1, 1> plant;
+
+	// with no kA the side has no dynamics worth a model, leave it to the Talons
+
+	if((rModel.fKv <= 0.0) || (rModel.fKa <= 0.01))
+	{
+		return(false);
+	}
+
+	A(0, 0) = -rModel.fKv / rModel.fKa;
+	B(0, 0) = 1.0 / rModel.fKa;
+	C(0, 0) = 1.0;
+	plant = Discretize(A, B, C, fStateSpacePeriod);
+
+	rLoop = StateSpaceLoop<1, 1, 1>(plant,
+			LqrGain(plant.A, plant.B, Diagonal<1>(1.0 / (fStateSpaceSpeedError * fStateSpaceSpeedError)),
+					Diagonal<1>(1.0 / (POWER_NOMINAL_VOLTAGE * POWER_NOMINAL_VOLTAGE))),
+			KalmanGain(plant.A, plant.C, Diagonal<1>(fStateSpaceModelError * fStateSpaceModelError),
+					Diagonal<1>(fStateSpaceSensorError * fStateSpaceSensorError)),
+			POWER_NOMINAL_VOLTAGE);
+
+	return(true);
+}
+
+bool Drivetrain::TestEnabled(void)
+{
+	// the message loop is blocked while we test, so ask the driver station directly
+
+	return(DriverStation::GetInstance().IsEnabled() && DriverStation::GetInstance().IsTest());
+}
+
+void Drivetrain::ApplyGains(const DriveGains &rGains)
+{
+	pLeftMotor->SelectProfileSlot(0);
+	pLeftMotor->SetPID(rGains.leftTalon.fP, rGains.leftTalon.fI, rGains.leftTalon.fD, rGains.leftTalon.fF);
+	pRightMotor->SelectProfileSlot(0);
+	pRightMotor->SetPID(rGains.rightTalon.fP, rGains.rightTalon.fI, rGains.rightTalon.fD, rGains.rightTalon.fF);
+	driveGains = rGains;
+
+	// the model is the same one either way, the roboRIO just does more with it
+
+	bStateSpaceDrive = STATESPACE_DRIVE && DesignVelocityLoop(rGains.leftModel, leftVelocity) &&
+			DesignVelocityLoop(rGains.rightModel, rightVelocity);
+
+	printf("drive gains left P %f I %f D %f F %f, right P %f I %f D %f F %f\n",
+			rGains.leftTalon.fP, rGains.leftTalon.fI, rGains.leftTalon.fD, rGains.leftTalon.fF,
+			rGains.rightTalon.fP, rGains.rightTalon.fI, rGains.rightTalon.fD, rGains.rightTalon.fF);
+}
+
+bool Drivetrain::CharacterizeTest(float fRamp, float fStep, float fTime,
+		DriveSample *pLeft, DriveSample *pRight, int &iCount)
+{
+	struct timespec tStart;
+	struct timespec tNext;
+	float fElapsed;
+	float fVolts;
+	float fDirection = ((fRamp + fStep) < 0.0) ? -1.0 : 1.0;
+	int iFirst = iCount;
+	bool bCompleted = true;
+
+	ZeroEncoders();
+	clock_gettime(CLOCK_MONOTONIC, &tStart);
+	tNext = tStart;
+
+	while(true)
+	{
+		// sample on a fixed period so the acceleration comes out right
+
+		TimespecAdd(tNext, fCharacterizePeriod);
+
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &tNext, NULL);
+		fElapsed = TimespecDiff(tNext, tStart);
+
+		if(!TestEnabled())
+		{
+			bCompleted = false;
+			break;
+		}
+
+		if((fElapsed > fTime) || (iCount >= DRIVECHARACTERIZE_MAX_SAMPLES) ||
+				(fabs((GetLeftCounts() + GetRightCounts()) / 2.0) / TALON_COUNTSPERREV * REVSPERFOOT > fCharacterizeDistance))
+		{
+			break;
+		}
+
+		// what the Talons put out last period and how fast that made the wheels go
+
+		pLeft[iCount].fTime = fElapsed;
+		pLeft[iCount].fVoltage = fDirection * fabs(pLeftMotor->GetOutputVoltage());
+		pLeft[iCount].fVelocity = -pLeftMotor->GetEncVel() * TALON_FEET_PER_NATIVE;
+		pRight[iCount].fTime = fElapsed;
+		pRight[iCount].fVoltage = fDirection * fabs(pRightMotor->GetOutputVoltage());
+		pRight[iCount].fVelocity = pRightMotor->GetEncVel() * TALON_FEET_PER_NATIVE;
+		iCount++;
+
+		fVolts = fStep + fRamp * fElapsed;
+		pLeftMotor->Set(PowerMonitor::GetInstance()->Compensate(-fVolts / POWER_NOMINAL_VOLTAGE, pLeftMotor, POWER_DRIVE_CURRENT, POWER_DRIVE_MOTORS));
+		pRightMotor->Set(PowerMonitor::GetInstance()->Compensate(fVolts / POWER_NOMINAL_VOLTAGE, pRightMotor, POWER_DRIVE_CURRENT, POWER_DRIVE_MOTORS));
+	}
+
+	pLeftMotor->Set(0.0);
+	pRightMotor->Set(0.0);
+
+	// each test on its own so we never difference across the rest between them
+
+	DriveCharacterize::Differentiate(pLeft + iFirst, iCount - iFirst);
+	DriveCharacterize::Differentiate(pRight + iFirst, iCount - iFirst);
+
+	Wait(fCharacterizeRest);
+	return(bCompleted);
+}
+
+void Drivetrain::Characterize(void)
+{
+	DriveSample *pLeft = new DriveSample[DRIVECHARACTERIZE_MAX_SAMPLES];
+	DriveSample *pRight = new DriveSample[DRIVECHARACTERIZE_MAX_SAMPLES];
+	DriveGains gains;
+	int iCount = 0;
+	bool bCompleted;
+
+	wpi_assert(pLeft && pRight);
+	SmartDashboard::PutBoolean("Characterize Drive", false);
+	printf("characterizing the drivetrain\n");
+
+	// the velocity usually comes every 20 ms, we want every sample
+
+	SetServoControl(false);
+	pLeftMotor->SetStatusFrameRateMs(CANTalon::StatusFrameRateFeedback, 5);
+	pRightMotor->SetStatusFrameRateMs(CANTalon::StatusFrameRateFeedback, 5);
+
+	bCompleted = CharacterizeTest(fCharacterizeRamp, 0.0, fCharacterizeRampTime, pLeft, pRight, iCount) &&
+			CharacterizeTest(-fCharacterizeRamp, 0.0, fCharacterizeRampTime, pLeft, pRight, iCount) &&
+			CharacterizeTest(0.0, fCharacterizeStep, fCharacterizeStepTime, pLeft, pRight, iCount) &&
+			CharacterizeTest(0.0, -fCharacterizeStep, fCharacterizeStepTime, pLeft, pRight, iCount);
+
+	pLeftMotor->SetStatusFrameRateMs(CANTalon::StatusFrameRateFeedback, 20);
+	pRightMotor->SetStatusFrameRateMs(CANTalon::StatusFrameRateFeedback, 20);
+
+	if(!bCompleted)
+	{
+		printf("characterization stopped after %d samples\n", iCount);
+	}
+	else if(!DriveCharacterize::Fit(pLeft, iCount, gains.leftModel) ||
+			!DriveCharacterize::Fit(pRight, iCount, gains.rightModel))
+	{
+		printf("characterization did not fit, left kV %f right kV %f\n",
+				gains.leftModel.fKv, gains.rightModel.fKv);
+	}
+	else
+	{
+		DriveCharacterize::DeriveGains(gains.leftModel, TALON_FEET_PER_NATIVE, gains.leftTalon);
+		DriveCharacterize::DeriveGains(gains.rightModel, TALON_FEET_PER_NATIVE, gains.rightTalon);
+
+		printf("left kS %f kV %f kA %f r2 %f, right kS %f kV %f kA %f r2 %f from %d samples\n",
+				gains.leftModel.fKs, gains.leftModel.fKv, gains.leftModel.fKa, gains.leftModel.fRSquared,
+				gains.rightModel.fKs, gains.rightModel.fKv, gains.rightModel.fKa, gains.rightModel.fRSquared,
+				iCount);
+
+		SmartDashboard::PutNumber("Left kS", gains.leftModel.fKs);
+		SmartDashboard::PutNumber("Left kV", gains.leftModel.fKv);
+		SmartDashboard::PutNumber("Left kA", gains.leftModel.fKa);
+		SmartDashboard::PutNumber("Right kS", gains.rightModel.fKs);
+		SmartDashboard::PutNumber("Right kV", gains.rightModel.fKv);
+		SmartDashboard::PutNumber("Right kA", gains.rightModel.fKa);
+
+		ApplyGains(gains);
+
+		if(!DriveCharacterize::Save(DRIVECHARACTERIZE_FILEPATH, gains))
+		{
+			printf("could not save %s\n", DRIVECHARACTERIZE_FILEPATH);
+		}
+	}
+
+	delete[] pLeft;
+	delete[] pRight;
+}
@@ -12,10 +12,62 @@
 #include <GearFloorIntake.h>
 #include <ComponentBase.h>
 #include <RobotParams.h>
+#include "PowerMonitor.h"
+#include <AutoSensors.h>
+#include <Timespec.h>
 #include "WPILib.h"
 
+#include <math.h>
+#include <time.h>
+
+#include <algorithm>
+
 //Robot
 
+// the arm's model and gains are worked out by the compiler
+
+static constexpr DiscretePlant<2, 1, 1> ArmPlant(void)
+{
+	Matrix<2, 2> A;
+	Matrix<2, 1> B;
+	Matrix<1, 2> C;
+
+	A(0, 1) = 1.0;
+	A(1, 1) = -fArmKv / fArmKa;
+	B(1, 0) = 1.0 / fArmKa;
+	C(0, 0) = 1.0;
+
+	return(Discretize(A, B, C, fArmPeriod));
+}
+
+static constexpr DiscretePlant<3, 1, 1> ArmObserverPlant(void)
+{
+	Matrix<3, 3> A;
+	Matrix<3, 1> B;
+	Matrix<1, 3> C;
+
+	// a third state for the volts the model does not explain, it stays put
+	// unless the measurements say otherwise
+
+	A(0, 1) = 1.0;
+	A(1, 1) = -fArmKv / fArmKa;
+	A(1, 2) = 1.0 / fArmKa;
+	B(1, 0) = 1.0 / fArmKa;
+	C(0, 0) = 1.0;
+
+	return(Discretize(A, B, C, fArmPeriod));
+}
+
+constexpr DiscretePlant<2, 1, 1> armPlant = ArmPlant();
+constexpr DiscretePlant<3, 1, 1> armObserverPlant = ArmObserverPlant();
+constexpr Matrix<1, 2> armK = LqrGain(armPlant.A, armPlant.B,
+		Diagonal<2>(1.0 / (fArmPositionError * fArmPositionError), 1.0 / (fArmSpeedError * fArmSpeedError)),
+		Diagonal<1>(1.0 / (fArmMaxVoltage * fArmMaxVoltage)));
+constexpr Matrix<3, 1> armL = KalmanGain(armObserverPlant.A, armObserverPlant.C,
+		Diagonal<3>(fArmModelError * fArmModelError, fArmModelSpeedError * fArmModelSpeedError,
+				fArmModelVoltageError * fArmModelVoltageError),
+		Diagonal<1>(fArmSensorError * fArmSensorError));
+
 GearFloorIntake::GearFloorIntake()
 : ComponentBase(GEARFLOORINTAKE_TASKNAME, GEARFLOORINTAKE_QUEUE, GEARFLOORINTAKE_PRIORITY)
 {
@@ -46,28 +98,207 @@ GearFloorIntake::GearFloorIntake()
 	pGearArmMotor->SetControlMode(CANTalon::kPercentVbus);
 
 	eCurrentPosition = ARMPOS_FLOOR;
+	fArmGoal = 0.0;
+	uArmGoalSet = 0;
+	uArmArrived = 0;
+	pArmTask = NULL;
+	fArmCommandReceived = 0.0;
+	bArmReplyPending = false;
 
 	pTask = new std::thread(&GearFloorIntake::StartTask, this, GEARFLOORINTAKE_TASKNAME, GEARFLOORINTAKE_PRIORITY);
 	wpi_assert(pTask);
+
+	if(ARM_STATESPACE)
+	{
+		pArmTask = new std::thread(&GearFloorIntake::StartArmTask, this, GEARARM_TASKNAME, GEARARM_PRIORITY);
+		wpi_assert(pArmTask);
+	}
 };
 
 void GearFloorIntake::InitGearArm()
 {
 	SmartDashboard::PutString("SETTING:", "ZERO");
-	pGearArmMotor->SetTalonControlMode(CANTalon::kPositionMode);
+
+	if(!ARM_STATESPACE)
+	{
+		pGearArmMotor->SetTalonControlMode(CANTalon::kPositionMode);
+	}
 
 	fDrivePosition =  (pGearArmMotor->GetPulseWidthPosition()*1.0)/4096;
 	fReleasePosition = fDrivePosition + fFromRobotToReleasePos;
 	fFloorPosition = fDrivePosition + fFromRobotToFloorPos;
 
-	pGearArmMotor->Set(fReleasePosition);
+	SetArmGoal(fReleasePosition);
 	eCurrentPosition = ARMPOS_RELEASE;
 	isInit = true;
 };
 
+void GearFloorIntake::SetArmGoal(float fGoal)
+{
+	// the goal goes first, so the arm thread never sees the new count with
+	// the old goal
+
+	fArmGoal = fGoal;
+	uArmGoalSet++;
+
+	if(!ARM_STATESPACE)
+	{
+		pGearArmMotor->Set(fGoal);
+	}
+}
+
+bool GearFloorIntake::ArmArrived(void)
+{
+	if(ARM_STATESPACE)
+	{
+		return(uArmArrived == uArmGoalSet);
+	}
+
+	return(fabs(pGearArmMotor->GetPulseWidthPosition() / 4096.0 - fArmGoal) < fArmArriveTolerance);
+}
+
+void GearFloorIntake::WaitForArm(void)
+{
+	// only autonomous's ARM asks to hear back, the joystick sends no timeout
+
+	if(localMessage.params.floor.fTimeout <= 0.0)
+	{
+		return;
+	}
+
+	// a new position ends the wait on the last one, it is not going there now
+	// so it failed, a JOIN waiting on it has to know
+
+	if(bArmReplyPending)
+	{
+		SendCommandResponse(armCommand, fArmCommandReceived, COMMAND_AUTONOMOUS_RESPONSE_ERROR, AUTO_COMPLETE_ERROR);
+	}
+
+	armCommand = localMessage;
+	fArmCommandReceived = fReceived;
+	bArmReplyPending = true;
+}
+
+void GearFloorIntake::ReplyWhenArrived(void)
+{
+	struct timespec tNow;
+
+	// called every pass of Run, autonomous hears back once the arm is there
+	// or its timeout is up
+
+	if(!bArmReplyPending)
+	{
+		return;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &tNow);
+
+	if(ArmArrived())
+	{
+		SendCommandResponse(armCommand, fArmCommandReceived, COMMAND_AUTONOMOUS_RESPONSE_OK, AUTO_COMPLETE_DONE);
+		bArmReplyPending = false;
+	}
+	else if((tNow.tv_sec + tNow.tv_nsec / 1.0e9) - fArmCommandReceived > armCommand.params.floor.fTimeout)
+	{
+		SendCommandResponse(armCommand, fArmCommandReceived, COMMAND_AUTONOMOUS_RESPONSE_OK, AUTO_COMPLETE_TIMEOUT);
+		bArmReplyPending = false;
+	}
+}
+
+void GearFloorIntake::RunArm()
+{
+	struct timespec tNext;
+	KalmanFilter<3, 1, 1> observer(armObserverPlant, armL);
+	PlantInversion<2, 1> feedforward(armPlant.A, armPlant.B);
+	Matrix<3, 1> x;
+	Matrix<2, 1> xArm;
+	Matrix<2, 1> r;
+	Matrix<1, 1> y;
+	Matrix<1, 1> u;
+	float fGoal;
+	float fDistance;
+	float fSpeed;
+	unsigned uGoal;
+	bool bRunning = false;
+
+	clock_gettime(CLOCK_MONOTONIC, &tNext);
+
+	while(true)
+	{
+		TimespecAdd(tNext, fArmPeriod);
+
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &tNext, NULL);
+		y(0, 0) = pGearArmMotor->GetPulseWidthPosition() / 4096.0;
+
+		// nothing to hold until the arm is zeroed, and it may have been moved
+		// by hand while we were disabled
+
+		if(!isInit || !DriverStation::GetInstance().IsEnabled())
+		{
+			bRunning = false;
+			continue;
+		}
+
+		if(!bRunning)
+		{
+			x = Matrix<3, 1>();
+			x(0, 0) = y(0, 0);
+			observer.Reset(x);
+			r = Matrix<2, 1>();
+			r(0, 0) = y(0, 0);
+			feedforward.Reset(r);
+			u = Matrix<1, 1>();
+			bRunning = true;
+		}
+
+		observer.Predict(u);
+		observer.Correct(y);
+
+		// move the reference toward the goal no faster than the arm can follow,
+		// slowing so it could stop there
+
+		uGoal = uArmGoalSet;
+		fGoal = fArmGoal;
+		fDistance = fGoal - r(0, 0);
+		fSpeed = std::min((float)sqrt(2.0 * fArmMaxAccel * fabs(fDistance)), fArmMaxSpeed);
+		fSpeed = (fDistance < 0.0) ? -fSpeed : fSpeed;
+		fSpeed = std::min(std::max(fSpeed, r(1, 0) - fArmMaxAccel * fArmPeriod), r(1, 0) + fArmMaxAccel * fArmPeriod);
+
+		if(fabs(fDistance) <= fabs(fSpeed) * fArmPeriod)
+		{
+			r(0, 0) = fGoal;
+			r(1, 0) = 0.0;
+		}
+		else
+		{
+			r(0, 0) += fSpeed * fArmPeriod;
+			r(1, 0) = fSpeed;
+		}
+
+		// LQR on where the arm is, the model's volts to follow the reference
+		// and whatever the disturbance state says gravity is taking
+
+		x = observer.GetState();
+		xArm(0, 0) = x(0, 0);
+		xArm(1, 0) = x(1, 0);
+		u = armK * (r - xArm) + feedforward.Calculate(r);
+		u(0, 0) = std::min(std::max(u(0, 0) - x(2, 0), -fArmMaxVoltage), fArmMaxVoltage);
+
+		// the reference has finished moving and the arm has caught up with it
+
+		if((r(0, 0) == fGoal) && (fabs(x(0, 0) - fGoal) < fArmArriveTolerance))
+		{
+			uArmArrived = uGoal;
+		}
+
+		pGearArmMotor->Set(PowerMonitor::GetInstance()->Compensate(u(0, 0) / POWER_NOMINAL_VOLTAGE, pGearArmMotor, POWER_ARM_CURRENT));
+	}
+}
+
 GearFloorIntake::~GearFloorIntake()
 {
 	delete pTask;
+	delete pArmTask;
 };
 
 void GearFloorIntake::OnStateChange()
@@ -113,6 +344,11 @@ void GearFloorIntake::Run()
 	float fPosition;
 	float motorspeed;
 
+	// the script may be waiting on the gear switch
+
+	AutoSensors::GetInstance()->Publish(AUTO_SENSOR_GEAR, pGearIntakeMotor->IsRevLimitSwitchClosed() ? 1.0 : 0.0);
+	ReplyWhenArrived();
+
 	if(iLoop % 10 == 0)
 	{
 		fStopMotor = pGearArmMotor->GetOutputCurrent();
@@ -125,6 +361,7 @@ void GearFloorIntake::Run()
 		SmartDashboard::PutNumber("FLOOR POS", fFloorPosition);
 		SmartDashboard::PutNumber("DRIVE POS", fDrivePosition);
 		SmartDashboard::PutNumber("RELEASE POS", fReleasePosition);
+		SmartDashboard::PutNumber("Arm Goal", fArmGoal);
 		SmartDashboard::PutNumber("Speed:", motorspeed);
 
 		// stay here if the current is exceeded
@@ -132,11 +369,11 @@ void GearFloorIntake::Run()
 		if(fStopMotor >= fMaxArmCurrent)
 		{
 			//pGearArmMotor->SetPosition(0);
-			pGearArmMotor->Set(fPosition);
+			SetArmGoal(fPosition/4096.0);
 		}
 
 		if(eCurrentPosition == ARMPOS_FLOOR && pGearIntakeMotor->IsRevLimitSwitchClosed()) {
-			pGearArmMotor->Set(fDrivePosition);
+			SetArmGoal(fDrivePosition);
 			eCurrentPosition = ARMPOS_DRIVE;
 			SmartDashboard::PutString("SETTING:", "DRIVE POS (1)");
 		}
@@ -149,57 +386,60 @@ void GearFloorIntake::Run()
 	switch(localMessage.command)			//Reads the message command
 	{
 	case COMMAND_MACRO_HANGGEAR:
-		pGearIntakeMotor->Set(0.4);
+		pGearIntakeMotor->Set(PowerMonitor::GetInstance()->Compensate(0.4, pGearIntakeMotor, POWER_INTAKE_CURRENT));
 		Wait(0.200);
 		pGearIntakeMotor->Set(0.0);
-		pGearArmMotor->Set(fFloorPosition);
+		SetArmGoal(fFloorPosition);
 		eCurrentPosition = ARMPOS_FLOOR;
 		Wait(0.400);
-		pGearArmMotor->Set(fReleasePosition);
+		SetArmGoal(fReleasePosition);
 		eCurrentPosition = ARMPOS_RELEASE;
 		Wait(0.100);
 		ClearMessages();
 		break;
 
 	case COMMAND_GEARFLOORINTAKE_INTAKEPOS:
-		pGearArmMotor->Set(fFloorPosition);
+		SetArmGoal(fFloorPosition);
 		eCurrentPosition = ARMPOS_FLOOR;
 		SmartDashboard::PutString("SETTING:", "INTAKE POS (0)");
+		WaitForArm();
 		break;
 
 	case COMMAND_GEARFLOORINTAKE_DRIVEPOS:
-		pGearArmMotor->Set(fDrivePosition);
+		SetArmGoal(fDrivePosition);
 		eCurrentPosition = ARMPOS_DRIVE;
 		SmartDashboard::PutString("SETTING:", "DRIVE POS (1)");
+		WaitForArm();
 		break;
 
 	case COMMAND_GEARFLOORINTAKE_RELEASEPOS:
-		pGearArmMotor->Set(fReleasePosition);
+		SetArmGoal(fReleasePosition);
 		eCurrentPosition = ARMPOS_RELEASE;
 		SmartDashboard::PutString("SETTING:", "SCORE POS(2)");
+		WaitForArm();
 		break;
 
 	case COMMAND_GEARFLOORINTAKE_NEXTPOS:
 		if(eCurrentPosition == ARMPOS_FLOOR)
 		{
-			pGearArmMotor->Set(fDrivePosition);
+			SetArmGoal(fDrivePosition);
 			eCurrentPosition = ARMPOS_DRIVE;
 		}
 		else if(eCurrentPosition == ARMPOS_DRIVE)
 		{
 			//pGearArmMotor->Set(fReleasePosition);
 
-			pGearArmMotor->Set(fReleasePosition);
+			SetArmGoal(fReleasePosition);
 			eCurrentPosition = ARMPOS_RELEASE;
 		}
 		else if(eCurrentPosition == ARMPOS_RELEASE)
 		{
-			pGearArmMotor->Set(fReleasePosition);
+			SetArmGoal(fReleasePosition);
 			eCurrentPosition = ARMPOS_RELEASE;
 		}
 		else
 		{
-			pGearArmMotor->Set(fDrivePosition);
+			SetArmGoal(fDrivePosition);
 			eCurrentPosition = ARMPOS_DRIVE;
 		}
 		break;
@@ -207,22 +447,22 @@ void GearFloorIntake::Run()
 	case COMMAND_GEARFLOORINTAKE_PREVPOS:
 		if(eCurrentPosition == ARMPOS_FLOOR)
 		{
-			pGearArmMotor->Set(fFloorPosition);
+			SetArmGoal(fFloorPosition);
 			eCurrentPosition = ARMPOS_FLOOR;
 		}
 		else if(eCurrentPosition == ARMPOS_DRIVE)
 		{
-			pGearArmMotor->Set(fFloorPosition);
+			SetArmGoal(fFloorPosition);
 			eCurrentPosition = ARMPOS_FLOOR;
 		}
 		else if(eCurrentPosition == ARMPOS_RELEASE)
 		{
-			pGearArmMotor->Set(fDrivePosition);
+			SetArmGoal(fDrivePosition);
 			eCurrentPosition = ARMPOS_DRIVE;
 		}
 		else
 		{
-			pGearArmMotor->Set(fDrivePosition);
+			SetArmGoal(fDrivePosition);
 			eCurrentPosition = ARMPOS_DRIVE;
 		}
 		break;
@@ -232,30 +472,30 @@ void GearFloorIntake::Run()
 		{
 			if(localMessage.params.floor.fSpeed > (fMaxIntakeSpeed / 3.0)) {
 
-				pGearIntakeMotor->Set(fMaxIntakeSpeed/3.0);
+				pGearIntakeMotor->Set(PowerMonitor::GetInstance()->Compensate(fMaxIntakeSpeed/3.0, pGearIntakeMotor, POWER_INTAKE_CURRENT));
 			}
 			else {
-				pGearIntakeMotor->Set(localMessage.params.floor.fSpeed);
+				pGearIntakeMotor->Set(PowerMonitor::GetInstance()->Compensate(localMessage.params.floor.fSpeed, pGearIntakeMotor, POWER_INTAKE_CURRENT));
 			}
 		}
 		else if(localMessage.params.floor.fSpeed > fMaxIntakeSpeed)
 		{
-			pGearIntakeMotor->Set(fMaxIntakeSpeed);
+			pGearIntakeMotor->Set(PowerMonitor::GetInstance()->Compensate(fMaxIntakeSpeed, pGearIntakeMotor, POWER_INTAKE_CURRENT));
 		}
 		else
 		{
-			pGearIntakeMotor->Set(localMessage.params.floor.fSpeed);
+			pGearIntakeMotor->Set(PowerMonitor::GetInstance()->Compensate(localMessage.params.floor.fSpeed, pGearIntakeMotor, POWER_INTAKE_CURRENT));
 		}
 		break;
 
 	case COMMAND_GEARFLOORINTAKE_PUSHOUT:
 		if(localMessage.params.floor.fSpeed > fMaxIntakeSpeed)
 		{
-			pGearIntakeMotor->Set(-fMaxIntakeSpeed);
+			pGearIntakeMotor->Set(PowerMonitor::GetInstance()->Compensate(-fMaxIntakeSpeed, pGearIntakeMotor, POWER_INTAKE_CURRENT));
 		}
 		else
 		{
-			pGearIntakeMotor->Set(-localMessage.params.floor.fSpeed);
+			pGearIntakeMotor->Set(PowerMonitor::GetInstance()->Compensate(-localMessage.params.floor.fSpeed, pGearIntakeMotor, POWER_INTAKE_CURRENT));
 		}
 		break;
 
@@ -14,10 +14,33 @@
 #include <ComponentBase.h>			//For ComponentBase class
 #include <pthread.h>
 #include <string>
+#include <atomic>
 #include <CANTalon.h>
 
 //Robot
 #include "WPILib.h"
+#include "StateSpace.h"
+
+// the arm can be held by our own state space loop on its own thread, the
+// Talon then only puts out volts.  The model constants are estimates from the
+// motor and gearing, not measured, the disturbance state in the Kalman filter
+// takes up gravity and whatever else they get wrong.  Leave it on the Talon's
+// position loop until kV and kA have been measured on the arm
+
+const bool ARM_STATESPACE = false;				// true runs the arm on our loop instead of the Talon's
+constexpr float fArmKv = 1.5;					// volts per rotation/s
+constexpr float fArmKa = 0.05;					// volts per rotation/s/s
+constexpr float fArmPeriod = 0.01;				// seconds between arm loop updates
+constexpr float fArmMaxVoltage = 6.0;			// same as the Talon's peak output
+constexpr float fArmMaxSpeed = 3.5;				// rotations/s the reference moves toward the goal at
+constexpr float fArmMaxAccel = 30.0;			// rotations/s/s
+constexpr float fArmPositionError = 0.01;		// rotations, LQR
+constexpr float fArmSpeedError = 0.5;			// rotations/s, LQR
+constexpr float fArmModelError = 0.001;			// rotations a period, Kalman
+constexpr float fArmModelSpeedError = 0.1;		// rotations/s a period
+constexpr float fArmModelVoltageError = 0.5;	// volts a period the disturbance may change by
+constexpr float fArmSensorError = 0.001;		// rotations of noise on the absolute encoder
+const float fArmArriveTolerance = 0.02;			// rotations from the goal we tell autonomous the arm got there
 
 
 typedef enum ArmPosition
@@ -43,6 +66,14 @@ public:
 		return(NULL);
 	}
 
+	static void *StartArmTask(void *pThis, const char* szComponentName, int iPriority)
+	{
+		pthread_setname_np(pthread_self(), szComponentName);
+		pthread_setschedprio(pthread_self(), iPriority);
+		((GearFloorIntake *)pThis)->RunArm();
+		return(NULL);
+	}
+
 private:
 	CANTalon* pGearArmMotor;
 	CANTalon* pGearIntakeMotor;
@@ -50,8 +81,16 @@ private:
 	float fFloorPosition;
 	float fDrivePosition;
 	float fReleasePosition;
-	bool isInit = false;
+	std::atomic<bool> isInit;			// the arm thread reads it too
 	ArmPosition eCurrentPosition;
+	std::atomic<float> fArmGoal;		// rotations, the arm thread moves the reference toward it
+	std::atomic<unsigned> uArmGoalSet;	// counts SetArmGoal calls
+	std::atomic<unsigned> uArmArrived;	// the count the arm thread last got to the goal for
+	std::thread *pArmTask;
+
+	RobotMessage armCommand;			// the ARM autonomous is waiting on
+	double fArmCommandReceived;
+	bool bArmReplyPending;
 
 	const float fFromRobotToFloorPos = 1.525;//-250.0;
 	//const float fFromFloorToDrivePos = 1.6195;//-250.0;
@@ -65,6 +104,11 @@ private:
 	void OnStateChange();
 	void Run();
 	void InitGearArm();
+	void SetArmGoal(float fGoal);
+	void WaitForArm(void);
+	void ReplyWhenArrived(void);
+	bool ArmArrived(void);
+	void RunArm();
 
 };
 
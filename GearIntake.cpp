@@ -12,6 +12,7 @@
 #include <GearIntake.h>
 #include <ComponentBase.h>
 #include <RobotParams.h>
+#include "PowerMonitor.h"
 #include "WPILib.h"
 
 //Robot
@@ -121,7 +122,7 @@ void GearIntake::Run()
 			}
 			else
 			{
-				pGearIntakeMotor->Set(-0.05);
+				pGearIntakeMotor->Set(PowerMonitor::GetInstance()->Compensate(-0.05, pGearIntakeMotor, POWER_INTAKE_CURRENT));
 			}
 
 			if(localMessage.command == COMMAND_GEARINTAKE_RELEASE)
@@ -18,6 +18,7 @@
 #include <CANTaLon.h>
 #include "Drivetrain.h"			//For the local header file
 #include "RobotParams.h"
+#include "PowerMonitor.h"
 //Robot
 
 Hopper::Hopper():
@@ -80,13 +81,13 @@ void Hopper::Run()
 		//TODO add command cases for Hopper
 		case COMMAND_HOPPER_UP:
 #ifndef USING_SOFTWARE_ROBOT
-			pHopperMotor->Set(localMessage.params.hopper.HopUp);
+			pHopperMotor->Set(PowerMonitor::GetInstance()->Compensate(localMessage.params.hopper.HopUp, pHopperMotor, POWER_HOPPER_CURRENT));
 #endif  // USING_SOFTWARE_ROBOT
 			break;
 
 		case COMMAND_HOPPER_DOWN:
 #ifndef USING_SOFTWARE_ROBOT
-			pHopperMotor->Set(localMessage.params.hopper.HopDown*-1);
+			pHopperMotor->Set(PowerMonitor::GetInstance()->Compensate(localMessage.params.hopper.HopDown*-1, pHopperMotor, POWER_HOPPER_CURRENT));
 #endif  // USING_SOFTWARE_ROBOT
 			break;
 
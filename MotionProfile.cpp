@@ -0,0 +1,167 @@
+/** \file
+ * Jerk limited velocity profile for the measured moves.
+ *
+ * The smoothed velocity at any time is the average of the trapezoid over the
+ * last fSmoothTime seconds, which is just the distance the trapezoid covered in
+ * that window divided by its length, so the table is built straight from the
+ * trapezoid's position.  Averaging adds half a window at the start speed and
+ * half at the end speed, Plan takes that off the trapezoid so the smoothed
+ * profile still covers the requested distance.
+ */
+
+#include <MotionProfile.h>
+#include <math.h>
+
+#include <algorithm>
+
+MotionProfile::MotionProfile()
+{
+	fStart = 0.0;
+	fPeak = 0.0;
+	fEnd = 0.0;
+	fAccelLimit = 0.0;
+	fSmoothTime = 0.0;
+	fAccelTime = 0.0;
+	fCruiseTime = 0.0;
+	fDecelTime = 0.0;
+	fPeriod = MOTIONPROFILE_PERIOD;
+	fDuration = 0.0;
+	iSamples = 0;
+}
+
+bool MotionProfile::Plan(float fDistance, float fStartVelocity, float fCruiseVelocity, float fEndVelocity,
+		float fAccel, float fJerk)
+{
+	float fTrapezoidDistance;
+	float fCruiseDistance;
+	float fTime;
+	float fLastVelocity;
+
+	iSamples = 0;
+	fDuration = 0.0;
+
+	if((fDistance <= 0.0) || (fCruiseVelocity <= 0.0) || (fAccel <= 0.0))
+	{
+		return(false);
+	}
+
+	fStart = std::min(fStartVelocity, fCruiseVelocity);
+	fEnd = std::min(fEndVelocity, fCruiseVelocity);
+	fAccelLimit = fAccel;
+
+	// a short move rolling in and out fast can not afford the whole window
+
+	fSmoothTime = (fJerk > 0.0) ? fAccel / fJerk : 0.0;
+
+	if((fStart + fEnd) * fSmoothTime > fDistance)
+	{
+		fSmoothTime = fDistance / (fStart + fEnd);
+	}
+
+	fSmoothTime = std::max(fSmoothTime, MOTIONPROFILE_PERIOD);
+	fTrapezoidDistance = std::max(fDistance - (fStart + fEnd) * fSmoothTime / 2.0f, 0.0f);
+
+	// the fastest we can get to and still slow down in time, if we are already
+	// going faster than that we can not make the exit speed and run a little long
+
+	fPeak = sqrt((2.0 * fAccel * fTrapezoidDistance + fStart * fStart + fEnd * fEnd) / 2.0);
+	fPeak = std::min(fPeak, fCruiseVelocity);
+	fPeak = std::max(fPeak, std::max(fStart, fEnd));
+
+	fAccelTime = (fPeak - fStart) / fAccel;
+	fDecelTime = (fPeak - fEnd) / fAccel;
+	fCruiseDistance = fTrapezoidDistance - (fPeak * fPeak - fStart * fStart) / (2.0 * fAccel) -
+			(fPeak * fPeak - fEnd * fEnd) / (2.0 * fAccel);
+	fCruiseTime = (fCruiseDistance > 0.0) ? fCruiseDistance / fPeak : 0.0;
+
+	fDuration = fAccelTime + fCruiseTime + fDecelTime + fSmoothTime;
+
+	// slow moves get a coarser table rather than a shorter one
+
+	fPeriod = std::max(MOTIONPROFILE_PERIOD, fDuration / (MOTIONPROFILE_MAX_SAMPLES - 2));
+	iSamples = std::min((int)ceil(fDuration / fPeriod) + 1, MOTIONPROFILE_MAX_SAMPLES);
+
+	fLastVelocity = fStart;
+	fVelocityTable[0] = fStart;
+	fPositionTable[0] = 0.0;
+
+	for(int i = 1; i < iSamples; i++)
+	{
+		fTime = i * fPeriod;
+		fVelocityTable[i] = (TrapezoidPosition(fTime) - TrapezoidPosition(fTime - fSmoothTime)) / fSmoothTime;
+		fPositionTable[i] = fPositionTable[i - 1] + (fLastVelocity + fVelocityTable[i]) * fPeriod / 2.0;
+		fLastVelocity = fVelocityTable[i];
+	}
+
+	return(true);
+}
+
+void MotionProfile::Sample(float fTime, MotionSample &rSample) const
+{
+	int iSample;
+	float fFraction;
+
+	if(iSamples == 0)
+	{
+		rSample.fPosition = 0.0;
+		rSample.fVelocity = 0.0;
+		rSample.fAccel = 0.0;
+	}
+	else if(fTime <= 0.0)
+	{
+		rSample.fPosition = 0.0;
+		rSample.fVelocity = fVelocityTable[0];
+		rSample.fAccel = 0.0;
+	}
+	else if(fTime >= fDuration)
+	{
+		// past the end we keep going at the exit speed, which is usually zero
+
+		rSample.fPosition = fPositionTable[iSamples - 1] + fEnd * (fTime - (iSamples - 1) * fPeriod);
+		rSample.fVelocity = fEnd;
+		rSample.fAccel = 0.0;
+	}
+	else
+	{
+		iSample = std::min((int)(fTime / fPeriod), iSamples - 2);
+		fFraction = fTime / fPeriod - iSample;
+
+		rSample.fPosition = fPositionTable[iSample] + (fPositionTable[iSample + 1] - fPositionTable[iSample]) * fFraction;
+		rSample.fVelocity = fVelocityTable[iSample] + (fVelocityTable[iSample + 1] - fVelocityTable[iSample]) * fFraction;
+		rSample.fAccel = (fVelocityTable[iSample + 1] - fVelocityTable[iSample]) / fPeriod;
+	}
+}
+
+float MotionProfile::TrapezoidPosition(float fTime) const
+{
+	float fAccelEnd = fAccelTime;
+	float fCruiseEnd = fAccelEnd + fCruiseTime;
+	float fDecelEnd = fCruiseEnd + fDecelTime;
+	float fAccelDistance = fStart * fAccelTime + fAccelLimit * fAccelTime * fAccelTime / 2.0;
+	float fCruiseDistance = fAccelDistance + fPeak * fCruiseTime;
+	float fDecelDistance = fCruiseDistance + fPeak * fDecelTime - fAccelLimit * fDecelTime * fDecelTime / 2.0;
+	float fSince;
+
+	// before the start we were already rolling at the start speed, after the end
+	// we carry on at the exit speed
+
+	if(fTime < 0.0)
+	{
+		return(fStart * fTime);
+	}
+	else if(fTime < fAccelEnd)
+	{
+		return(fStart * fTime + fAccelLimit * fTime * fTime / 2.0);
+	}
+	else if(fTime < fCruiseEnd)
+	{
+		return(fAccelDistance + fPeak * (fTime - fAccelEnd));
+	}
+	else if(fTime < fDecelEnd)
+	{
+		fSince = fTime - fCruiseEnd;
+		return(fCruiseDistance + fPeak * fSince - fAccelLimit * fSince * fSince / 2.0);
+	}
+
+	return(fDecelDistance + fEnd * (fTime - fDecelEnd));
+}
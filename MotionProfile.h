@@ -0,0 +1,64 @@
+/** \file
+ * Jerk limited velocity profile for the measured moves.
+ *
+ * Plan builds a trapezoid (speed up at the acceleration limit, cruise, slow
+ * down to the exit speed) and then runs the trapezoid's velocity through a
+ * moving average as long as it takes to reach full acceleration at the jerk
+ * limit.  That rounds every corner of the trapezoid into an S.  The result is
+ * kept as a table at the control rate so the drive loop only looks it up.
+ *
+ * Distances are feet and speeds feet per second for the moves, degrees and
+ * degrees per second for TURN, always positive, the caller decides which way
+ * the robot goes.
+ *
+ * Nothing in here depends on WPILib so the tools can use it too.
+ */
+
+#ifndef MOTIONPROFILE_H
+#define MOTIONPROFILE_H
+
+const float MOTIONPROFILE_PERIOD = 0.005;		// seconds, the drivetrain's auto loop
+const int MOTIONPROFILE_MAX_SAMPLES = 4000;		// 20 seconds at the control rate
+
+///Where the profile says we should be
+struct MotionSample {
+	float fPosition;		//!< feet from the start
+	float fVelocity;		//!< feet/second
+	float fAccel;			//!< feet/second/second
+};
+
+class MotionProfile
+{
+public:
+	MotionProfile();
+
+	bool Plan(float fDistance, float fStartVelocity, float fCruiseVelocity, float fEndVelocity,
+			float fAccel, float fJerk);
+	void Sample(float fTime, MotionSample &rSample) const;
+	float GetDuration() const { return(fDuration); };
+	bool IsDone(float fTime) const { return(fTime >= fDuration); };
+
+private:
+	float TrapezoidPosition(float fTime) const;
+
+	// the trapezoid
+
+	float fStart;
+	float fPeak;
+	float fEnd;
+	float fAccelLimit;
+	float fSmoothTime;			//!< length of the moving average, acceleration over jerk
+	float fAccelTime;
+	float fCruiseTime;
+	float fDecelTime;
+
+	// the smoothed table
+
+	float fPeriod;				//!< seconds between samples, longer than the control rate for slow moves
+	float fDuration;
+	int iSamples;
+	float fVelocityTable[MOTIONPROFILE_MAX_SAMPLES];
+	float fPositionTable[MOTIONPROFILE_MAX_SAMPLES];
+};
+
+#endif  // MOTIONPROFILE_H
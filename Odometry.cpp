@@ -0,0 +1,137 @@
+/** \file
+ * Keeps track of where the robot is on the field.
+ *
+ * The encoders give the distance each side went since the last period and the
+ * gyro gives the heading, the robot is assumed to have gone in a straight line
+ * at the heading half way between.  At 200 times a second that is as good as
+ * an arc.
+ */
+
+#include "Odometry.h"
+#include "Drivetrain.h"
+#include "Timespec.h"
+
+#include <math.h>
+#include <time.h>
+
+SeqLock<RobotPose> Odometry::published;
+
+Odometry::Odometry(CANTalon *pLeft, CANTalon *pRight, ADXRS453Z *pHeadingGyro)
+{
+	pLeftMotor = pLeft;
+	pRightMotor = pRight;
+	pGyro = pHeadingGyro;
+
+	pose.fTimestamp = 0.0;
+	pose.fX = 0.0;
+	pose.fY = 0.0;
+	pose.fHeading = 0.0;
+	pose.fVelocity = 0.0;
+	pose.fTurnRate = 0.0;
+
+	iLastLeft = -pLeftMotor->GetEncPosition();
+	iLastRight = pRightMotor->GetEncPosition();
+	fGyroAtReset = pGyro->GetHeading();
+	fHeadingAtReset = 0.0;
+	uResetsDone = 0;
+
+	pTask = new std::thread(&Odometry::StartTask, this, ODOMETRY_TASKNAME, ODOMETRY_PRIORITY);
+	wpi_assert(pTask);
+}
+
+Odometry::~Odometry()
+{
+	delete pTask;
+}
+
+void Odometry::Run(void)
+{
+	struct timespec tNext;
+
+	// run on a fixed period, not a fixed sleep, so a slow read does not
+	// push every period after it
+
+	clock_gettime(CLOCK_MONOTONIC, &tNext);
+
+	while(true)
+	{
+		TimespecAdd(tNext, ODOMETRY_PERIOD);
+
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &tNext, NULL);
+		Iterate();
+	}
+}
+
+void Odometry::Reset(float fX, float fY, float fHeading)
+{
+	RobotPose request;
+
+	// the odometry thread picks this up next period, it is the only one that
+	// writes the pose
+
+	request.fTimestamp = 0.0;
+	request.fX = fX;
+	request.fY = fY;
+	request.fHeading = fHeading;
+	request.fVelocity = 0.0;
+	request.fTurnRate = 0.0;
+	resetRequest.Write(request);
+}
+
+unsigned Odometry::GetPose(RobotPose &rPose)
+{
+	return(published.Read(rPose));
+}
+
+void Odometry::Iterate(void)
+{
+	struct timespec tNow;
+	RobotPose request;
+	double fTime;
+	int iLeft = -pLeftMotor->GetEncPosition();
+	int iRight = pRightMotor->GetEncPosition();
+	float fGyro = pGyro->GetHeading();
+	float fLeft;
+	float fRight;
+	float fDistance;
+	float fHeading;
+
+	clock_gettime(CLOCK_MONOTONIC, &tNow);
+	fTime = tNow.tv_sec + tNow.tv_nsec / 1.0e9;
+
+	if(resetRequest.GetWrites() != uResetsDone)
+	{
+		uResetsDone = resetRequest.Read(request);
+		pose.fX = request.fX;
+		pose.fY = request.fY;
+		pose.fHeading = request.fHeading;
+		fHeadingAtReset = request.fHeading;
+		fGyroAtReset = fGyro;
+	}
+
+	fLeft = (iLeft - iLastLeft) / TALON_COUNTSPERREV * REVSPERFOOT;
+	fRight = (iRight - iLastRight) / TALON_COUNTSPERREV * REVSPERFOOT;
+	iLastLeft = iLeft;
+	iLastRight = iRight;
+
+	// nothing zeroes the Talons any more, a step this big is a glitch on the
+	// CAN bus or a Talon that reset, not the robot moving
+
+	if((fabs(fLeft) > ODOMETRY_MAX_STEP) || (fabs(fRight) > ODOMETRY_MAX_STEP))
+	{
+		fLeft = 0.0;
+		fRight = 0.0;
+	}
+
+	fDistance = (fLeft + fRight) / 2.0;
+	fHeading = fHeadingAtReset - (fGyro - fGyroAtReset) * M_PI / 180.0;
+
+	pose.fX += fDistance * cos((fHeading + pose.fHeading) / 2.0);
+	pose.fY += fDistance * sin((fHeading + pose.fHeading) / 2.0);
+	pose.fHeading = fHeading;
+	pose.fVelocity = (pose.fTimestamp > 0.0) ? fDistance / (fTime - pose.fTimestamp) : 0.0;
+	pose.fTurnRate = -pGyro->GetRate() * M_PI / 180.0;
+	pose.fTimestamp = fTime;
+
+	published.Write(pose);
+}
@@ -0,0 +1,75 @@
+/** \file
+ * Keeps track of where the robot is on the field.
+ *
+ * A thread of its own reads the drive encoders and the gyro every control
+ * period and adds up the moves into a pose, feet from wherever it was last
+ * reset and radians counter clockwise.  The pose goes out through a SeqLock
+ * so autonomous, the dashboard and the logs can all read it without ever
+ * holding up the thread that makes it.
+ */
+
+#ifndef ODOMETRY_H
+#define ODOMETRY_H
+
+#include <pthread.h>
+#include <thread>
+
+//Robot
+#include <WPILib.h>
+#include <CANTalon.h>
+
+#include "ADXRS453Z.h"
+#include "RobotParams.h"
+#include "SeqLock.h"
+
+const double ODOMETRY_PERIOD = 0.005;	// seconds, same as the auto drive loops
+const float ODOMETRY_MAX_STEP = 0.5;	// feet in one period, more than that is an encoder glitch
+
+///Where the robot is and how it is moving
+struct RobotPose {
+	double fTimestamp;		//!< CLOCK_MONOTONIC seconds the encoders and gyro were read
+	float fX;				//!< feet
+	float fY;				//!< feet
+	float fHeading;			//!< radians counter clockwise, does not wrap
+	float fVelocity;		//!< feet/second, forward positive
+	float fTurnRate;		//!< radians/second counter clockwise
+};
+
+class Odometry
+{
+public:
+	Odometry(CANTalon *pLeft, CANTalon *pRight, ADXRS453Z *pHeadingGyro);
+	~Odometry();
+
+	static void *StartTask(void *pThis, const char* szComponentName, int iPriority)
+	{
+		pthread_setname_np(pthread_self(), szComponentName);
+		pthread_setschedprio(pthread_self(), iPriority);
+		((Odometry *)pThis)->Run();
+		return(NULL);
+	}
+
+	void Run(void);
+	void Reset(float fX, float fY, float fHeading);
+	static unsigned GetPose(RobotPose &rPose);
+
+private:
+	void Iterate(void);
+
+	CANTalon *pLeftMotor;
+	CANTalon *pRightMotor;
+	ADXRS453Z *pGyro;
+	std::thread *pTask;
+
+	RobotPose pose;					//!< only the odometry thread touches this
+	int iLastLeft;
+	int iLastRight;
+	float fGyroAtReset;				//!< degrees clockwise from ADXRS453Z::GetHeading
+	float fHeadingAtReset;
+	unsigned uResetsDone;
+
+	SeqLock<RobotPose> resetRequest;	//!< written by Reset, only ever from the drivetrain task
+	static SeqLock<RobotPose> published;
+};
+
+#endif			//ODOMETRY_H
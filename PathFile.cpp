@@ -0,0 +1,160 @@
+/** \file
+ * Trajectories for the PATH script command.
+ *
+ * The whole file is mapped with MAP_POPULATE so the pages are read in while we
+ * check it, following the path never waits on the flash.  A file that fails
+ * any check is not used at all rather than driving part of it.
+ */
+
+#include <PathFile.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+PathFile::PathFile()
+{
+	pMapped = NULL;
+	uMappedSize = 0;
+	pSamples = NULL;
+	iCount = 0;
+	fPeriod = 0.0;
+	tModified = 0;
+}
+
+PathFile::~PathFile()
+{
+	Close();
+}
+
+bool PathFile::Open(const char *szPath)
+{
+	struct stat fileStat;
+	int iFile;
+	void *pMap;
+
+	if(stat(szPath, &fileStat) != 0)
+	{
+		Close();
+		return(false);
+	}
+
+	// we only map the file again if it changed
+
+	if(IsOpen() && (sName == szPath) && (tModified == fileStat.st_mtime))
+	{
+		return(true);
+	}
+
+	Close();
+
+	if(fileStat.st_size < (off_t)sizeof(PathHeader))
+	{
+		printf("PathFile %s is too short\n", szPath);
+		return(false);
+	}
+
+	iFile = open(szPath, O_RDONLY);
+
+	if(iFile < 0)
+	{
+		return(false);
+	}
+
+	pMap = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, iFile, 0);
+	close(iFile);
+
+	if(pMap == MAP_FAILED)
+	{
+		printf("PathFile could not map %s\n", szPath);
+		return(false);
+	}
+
+	pMapped = pMap;
+	uMappedSize = fileStat.st_size;
+
+	if(!Validate(*(const PathHeader *)pMapped, uMappedSize))
+	{
+		printf("PathFile %s is not a path from this build\n", szPath);
+		Close();
+		return(false);
+	}
+
+	pSamples = (const PathSample *)((const char *)pMapped + sizeof(PathHeader));
+	iCount = ((const PathHeader *)pMapped)->uCount;
+	fPeriod = ((const PathHeader *)pMapped)->fPeriod;
+	sName = szPath;
+	tModified = fileStat.st_mtime;
+	return(true);
+}
+
+void PathFile::Close()
+{
+	if(pMapped)
+	{
+		munmap(pMapped, uMappedSize);
+	}
+
+	pMapped = NULL;
+	uMappedSize = 0;
+	pSamples = NULL;
+	iCount = 0;
+	fPeriod = 0.0;
+	sName.clear();
+}
+
+bool PathFile::Validate(const PathHeader &rHeader, size_t uFileSize)
+{
+	const PathSample *pCheck = (const PathSample *)((const char *)pMapped + sizeof(PathHeader));
+
+	if((rHeader.uMagic != PATHFILE_MAGIC) || (rHeader.uVersion != PATHFILE_VERSION) ||
+			(rHeader.uSampleSize != sizeof(PathSample)) || (rHeader.uCount == 0) ||
+			(rHeader.uCount > (uint32_t)PATHFILE_MAX_SAMPLES) ||
+			(uFileSize != sizeof(PathHeader) + rHeader.uCount * sizeof(PathSample)) ||
+			!(rHeader.fPeriod > 0.0) || (rHeader.fPeriod > 0.1))
+	{
+		return(false);
+	}
+
+	// a NaN in here would drive the robot somewhere we can not predict
+
+	for(uint32_t i = 0; i < rHeader.uCount; i++)
+	{
+		if(!isfinite(pCheck[i].fX) || !isfinite(pCheck[i].fY) || !isfinite(pCheck[i].fHeading) ||
+				!(fabs(pCheck[i].fVelocity) <= PATHFILE_MAX_SPEED) ||
+				!(fabs(pCheck[i].fCurvature) <= PATHFILE_MAX_CURVATURE))
+		{
+			printf("PathFile sample %u is out of range\n", i);
+			return(false);
+		}
+	}
+
+	return(true);
+}
+
+bool PathFile::Write(const char *szPath, const PathSample *pWrite, int iWriteCount, float fWritePeriod)
+{
+	PathHeader header;
+	FILE *pFile;
+	bool bReturn;
+
+	header.uMagic = PATHFILE_MAGIC;
+	header.uVersion = PATHFILE_VERSION;
+	header.uSampleSize = sizeof(PathSample);
+	header.uCount = iWriteCount;
+	header.fPeriod = fWritePeriod;
+
+	pFile = fopen(szPath, "wb");
+
+	if(!pFile)
+	{
+		return(false);
+	}
+
+	bReturn = (fwrite(&header, sizeof(header), 1, pFile) == 1) &&
+			(fwrite(pWrite, sizeof(PathSample), iWriteCount, pFile) == (size_t)iWriteCount);
+	fclose(pFile);
+	return(bReturn);
+}
@@ -0,0 +1,79 @@
+/** \file
+ * Trajectories for the PATH script command.
+ *
+ * tools/PathGen fits quintic Hermite splines through a list of waypoints, works
+ * out how fast the robot can go along them and writes where the robot should be
+ * every control period.  The robot maps the file read only and checks it over
+ * while disabled, so following a path is just reading the next sample, nothing
+ * is evaluated or allocated in autonomous.
+ *
+ * The file is a PathHeader followed by uCount PathSamples, fPeriod seconds
+ * apart.  Positions are feet from the first waypoint, headings are radians
+ * counter clockwise, the same as the waypoints.
+ *
+ * Nothing in here depends on WPILib so the tools can use it too.
+ */
+
+#ifndef PATHFILE_H
+#define PATHFILE_H
+
+#include <stdint.h>
+#include <time.h>
+
+#include <string>
+
+const uint32_t PATHFILE_MAGIC = 0x50534852;		// "RHSP"
+const uint16_t PATHFILE_VERSION = 1;
+const int PATHFILE_MAX_SAMPLES = 6000;			// 30 seconds at the control rate
+const float PATHFILE_MAX_SPEED = 20.0;			// feet/second, anything faster is a bad file
+const float PATHFILE_MAX_CURVATURE = 20.0;		// 1/feet, tighter than the robot can turn in place
+
+///Start of a path file
+struct PathHeader {
+	uint32_t uMagic;
+	uint16_t uVersion;
+	uint16_t uSampleSize;		//!< sizeof(PathSample)
+	uint32_t uCount;
+	float fPeriod;				//!< seconds between samples
+};
+
+///Where the robot should be at one control period
+struct PathSample {
+	float fX;					//!< feet
+	float fY;					//!< feet
+	float fHeading;				//!< radians, counter clockwise
+	float fVelocity;			//!< feet/second along the path
+	float fCurvature;			//!< 1/feet, positive turns left
+};
+
+class PathFile
+{
+public:
+	PathFile();
+	~PathFile();
+
+	bool Open(const char *szPath);
+	void Close();
+	bool IsOpen() const { return(pSamples != NULL); };
+	const char *GetName() const { return(sName.c_str()); };
+
+	int GetCount() const { return(iCount); };
+	float GetPeriod() const { return(fPeriod); };
+	float GetDuration() const { return(iCount * fPeriod); };
+	const PathSample &GetSample(int iSample) const { return(pSamples[iSample]); };
+
+	static bool Write(const char *szPath, const PathSample *pWrite, int iWriteCount, float fWritePeriod);
+
+private:
+	bool Validate(const PathHeader &rHeader, size_t uFileSize);
+
+	void *pMapped;
+	size_t uMappedSize;
+	const PathSample *pSamples;		//!< in the mapping, NULL if nothing is open
+	int iCount;
+	float fPeriod;
+	std::string sName;
+	time_t tModified;
+};
+
+#endif  // PATHFILE_H
@@ -0,0 +1,154 @@
+/** \file
+ * Watches the battery so the motors get the same voltage all match.
+ *
+ * The resistance only shows when the load changes, so we compare each PDP
+ * reading with the one a few periods back and only believe the pair if the
+ * current moved enough for the voltage change to be more than noise.  The
+ * open circuit voltage drifts down slowly as the battery drains and is
+ * worked out from every reading with the resistance we have.
+ */
+
+#include "PowerMonitor.h"
+#include "Timespec.h"
+
+#include <math.h>
+#include <time.h>
+
+#include <algorithm>
+
+PowerMonitor *PowerMonitor::GetInstance()
+{
+	// never destroyed, the thread runs until the robot program ends
+
+	static PowerMonitor *pMonitor = new PowerMonitor();
+
+	return(pMonitor);
+}
+
+PowerMonitor::PowerMonitor()
+{
+	pPDP = new PowerDistributionPanel();
+	wpi_assert(pPDP);
+
+	state.fTimestamp = 0.0;
+	state.fVoltage = pPDP->GetVoltage();
+	state.fCurrent = pPDP->GetTotalCurrent();
+	state.fResistance = POWER_START_RESISTANCE;
+	state.fOpenVoltage = state.fVoltage + state.fResistance * state.fCurrent;
+
+	for(int i = 0; i < POWER_HISTORY; i++)
+	{
+		fVoltageHistory[i] = state.fVoltage;
+		fCurrentHistory[i] = state.fCurrent;
+	}
+
+	iHistory = 0;
+	published.Write(state);
+
+	pTask = new std::thread(&PowerMonitor::StartTask, this, POWERMONITOR_TASKNAME, POWERMONITOR_PRIORITY);
+	wpi_assert(pTask);
+}
+
+PowerMonitor::~PowerMonitor()
+{
+	delete pTask;
+	delete pPDP;
+}
+
+void PowerMonitor::Run(void)
+{
+	struct timespec tNext;
+
+	clock_gettime(CLOCK_MONOTONIC, &tNext);
+
+	while(true)
+	{
+		TimespecAdd(tNext, POWER_PERIOD);
+
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &tNext, NULL);
+		Iterate();
+	}
+}
+
+unsigned PowerMonitor::GetState(PowerState &rState)
+{
+	return(published.Read(rState));
+}
+
+float PowerMonitor::PredictVoltage(float fExtraCurrent)
+{
+	PowerState battery;
+	float fPredicted;
+
+	// what the bus sags to with the load we have now plus whatever the
+	// caller is about to add
+
+	published.Read(battery);
+	fPredicted = battery.fOpenVoltage - battery.fResistance * (battery.fCurrent + fExtraCurrent);
+
+	return(std::min(std::max(fPredicted, POWER_MIN_VOLTAGE), POWER_MAX_VOLTAGE));
+}
+
+float PowerMonitor::Compensate(float fOutput, float fPresentCurrent, float fFullCurrent)
+{
+	float fExtraCurrent;
+	float fCompensated;
+
+	// the PDP total already has what the motor draws now, only the change
+	// from that to what the new output will draw is extra
+
+	fExtraCurrent = fabs(fOutput) * fFullCurrent - fPresentCurrent;
+	fCompensated = fOutput * POWER_NOMINAL_VOLTAGE / PredictVoltage(fExtraCurrent);
+
+	return(std::min(std::max(fCompensated, -1.0f), 1.0f));
+}
+
+float PowerMonitor::Compensate(float fOutput, CANTalon *pMotor, float fFullCurrent, int iMotors)
+{
+	// followers draw what the motor they follow does
+
+	return(Compensate(fOutput, pMotor->GetOutputCurrent() * iMotors, fFullCurrent * iMotors));
+}
+
+void PowerMonitor::Iterate(void)
+{
+	struct timespec tNow;
+	float fVoltage = pPDP->GetVoltage();
+	float fCurrent = pPDP->GetTotalCurrent();
+	float fVoltageStep;
+	float fCurrentStep;
+	float fResistance;
+
+	clock_gettime(CLOCK_MONOTONIC, &tNow);
+
+	// a bad CAN read is not the battery
+
+	if(!(fVoltage > 0.0) || !(fCurrent >= 0.0))
+	{
+		return;
+	}
+
+	// the oldest reading is the one we are about to write over
+
+	fVoltageStep = fVoltage - fVoltageHistory[iHistory];
+	fCurrentStep = fCurrent - fCurrentHistory[iHistory];
+	fVoltageHistory[iHistory] = fVoltage;
+	fCurrentHistory[iHistory] = fCurrent;
+	iHistory = (iHistory + 1) % POWER_HISTORY;
+
+	if(fabs(fCurrentStep) >= POWER_MIN_STEP)
+	{
+		fResistance = -fVoltageStep / fCurrentStep;
+
+		if((fResistance >= POWER_MIN_RESISTANCE) && (fResistance <= POWER_MAX_RESISTANCE))
+		{
+			state.fResistance += POWER_RESISTANCE_FILTER * (fResistance - state.fResistance);
+		}
+	}
+
+	state.fTimestamp = tNow.tv_sec + tNow.tv_nsec / 1.0e9;
+	state.fVoltage = fVoltage;
+	state.fCurrent = fCurrent;
+	state.fOpenVoltage += POWER_VOLTAGE_FILTER * (fVoltage + state.fResistance * fCurrent - state.fOpenVoltage);
+	published.Write(state);
+}
@@ -0,0 +1,98 @@
+/** \file
+ * Watches the battery so the motors get the same voltage all match.
+ *
+ * A thread of its own reads the bus voltage and the total current from the
+ * PDP every control period.  The battery looks like a perfect source behind a
+ * resistance, so every time the load jumps the voltage drops by the jump
+ * times that resistance.  Those jumps give an estimate of the resistance and
+ * from it the voltage the battery would have with nothing running.  Together
+ * they predict what the bus will sag to under a load.
+ *
+ * Motor outputs in percent of the bus go through Compensate, which scales
+ * them up as the predicted bus goes down so 0.5 means 6 volts at the motor
+ * with a fresh battery or a tired one.  The bus it predicts is the one under
+ * the new output, the Talon tells us what the motor draws now and the motor
+ * draws its full current times the output, so turning a motor up sags the
+ * bus before the PDP sees it.
+ */
+
+#ifndef POWERMONITOR_H
+#define POWERMONITOR_H
+
+#include <pthread.h>
+#include <thread>
+
+//Robot
+#include <WPILib.h>
+#include <CANTalon.h>
+
+#include "RobotParams.h"
+#include "SeqLock.h"
+
+const double POWER_PERIOD = 0.005;				// seconds, same as the auto drive loops
+const float POWER_NOMINAL_VOLTAGE = 12.0;		// what the outputs are tuned for
+const float POWER_MIN_VOLTAGE = 7.0;			// never scale up more than 12/7, the roboRIO browns out below this
+const float POWER_MAX_VOLTAGE = 13.5;
+const int POWER_HISTORY = 10;					// periods between the readings we compare, the PDP is slower than us
+const float POWER_MIN_STEP = 10.0;				// amps, smaller load changes are lost in the noise
+const float POWER_MIN_RESISTANCE = 0.005;		// ohms, anything outside this is a bad pair of readings
+const float POWER_MAX_RESISTANCE = 0.1;
+const float POWER_START_RESISTANCE = 0.02;		// a good battery and the main breaker
+const float POWER_RESISTANCE_FILTER = 0.05;		// of each new resistance reading we take
+const float POWER_VOLTAGE_FILTER = 0.01;		// of each new open circuit reading we take
+
+// amps one motor draws at full output on its mechanism, pushing hard but not
+// stalled, a motor at half output draws about half of it
+const float POWER_DRIVE_CURRENT = 60.0;
+const float POWER_CLIMBER_CURRENT = 40.0;
+const float POWER_HOPPER_CURRENT = 20.0;
+const float POWER_INTAKE_CURRENT = 20.0;		// the rollers on either gear intake
+const float POWER_ARM_CURRENT = 10.0;
+const int POWER_DRIVE_MOTORS = 2;				// per side, the slave follows the one we set
+
+///What the battery is doing
+struct PowerState {
+	double fTimestamp;		//!< CLOCK_MONOTONIC seconds of the PDP reading
+	float fVoltage;			//!< volts on the bus
+	float fCurrent;			//!< amps out of the PDP
+	float fOpenVoltage;		//!< volts with nothing running
+	float fResistance;		//!< ohms, battery, breaker and wiring
+};
+
+class PowerMonitor
+{
+public:
+	static PowerMonitor *GetInstance();
+
+	static void *StartTask(void *pThis, const char* szComponentName, int iPriority)
+	{
+		pthread_setname_np(pthread_self(), szComponentName);
+		pthread_setschedprio(pthread_self(), iPriority);
+		((PowerMonitor *)pThis)->Run();
+		return(NULL);
+	}
+
+	void Run(void);
+	unsigned GetState(PowerState &rState);
+	float PredictVoltage(float fExtraCurrent = 0.0);
+	float Compensate(float fOutput, float fPresentCurrent, float fFullCurrent);
+	float Compensate(float fOutput, CANTalon *pMotor, float fFullCurrent, int iMotors = 1);
+
+private:
+	PowerMonitor();
+	~PowerMonitor();
+
+	void Iterate(void);
+
+	PowerDistributionPanel *pPDP;
+	std::thread *pTask;
+
+	PowerState state;							//!< only the power thread touches this
+	float fVoltageHistory[POWER_HISTORY];
+	float fCurrentHistory[POWER_HISTORY];
+	int iHistory;								//!< next slot, also the oldest reading
+
+	SeqLock<PowerState> published;
+};
+
+#endif			//POWERMONITOR_H
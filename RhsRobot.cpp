@@ -9,6 +9,7 @@
 #include <ComponentBase.h>
 #include <RhsRobot.h>
 #include <RobotParams.h>
+#include "PowerMonitor.h"
 #include "WPILib.h"
 
 // The constructor sets the pointer to our objects to NULL.  We use pointers so we
@@ -24,6 +25,7 @@ RhsRobot::RhsRobot() {
 	pHopper = NULL;
 	pGearIntake = NULL;
 	pGearFloor = NULL;
+	pRecorder = NULL;      // records the driver so autonomous can play it back
 
 	bHopperRunning = false;
 	bGearButtonDown = false;
@@ -32,8 +34,6 @@ RhsRobot::RhsRobot() {
 	camera.SetVideoMode(cs::VideoMode::kMJPEG, 320, 240, 15);
 
     // set new object pointers to NULL here
-
-	iLoop = 0;            // a helpful little loop counter
 }
 
 // This will never get used but we make it functional anyways.  We iterate through our objects
@@ -58,7 +58,7 @@ RhsRobot::~RhsRobot() {
 	delete pHopper;
 	delete pGearIntake;
 	delete pGearFloor;
-
+	delete pRecorder;
 }
 
 void RhsRobot::Init() {
@@ -67,6 +67,8 @@ void RhsRobot::Init() {
 	 * EXAMPLE:	drivetrain = NULL; (in constructor)
 	 * 			drivetrain = new Drivetrain(); (in RhsRobot::Init())
 	 */
+	PowerMonitor::GetInstance();  // start watching the battery before anything drives
+
 	pController_1 = new Joystick(0);
 	pController_2 = new Joystick(1);
 	pDrivetrain = new Drivetrain();
@@ -75,6 +77,9 @@ void RhsRobot::Init() {
 	//pGearIntake = new GearIntake();
 	pGearFloor = new GearFloorIntake();
 	pAutonomous = new Autonomous();
+	pRecorder = new DriveRecorder();
+
+	SmartDashboard::PutBoolean("Record Teleop", false);
 
 	std::vector<ComponentBase *>::iterator nextComponent = ComponentSet.begin();
 
@@ -122,6 +127,33 @@ void RhsRobot::OnStateChange() {
 	{
 		(*nextComponent)->SendMessage(&robotMessage);
 	}
+
+	// record teleop if asked to, the file is written when teleop ends
+
+	if(pRecorder)
+	{
+		if(pRecorder->IsRecording() && (GetCurrentRobotState() != ROBOT_STATE_TELEOPERATED))
+		{
+			pRecorder->Stop(DRIVERECORDER_FILEPATH);
+		}
+		else if((GetCurrentRobotState() == ROBOT_STATE_TELEOPERATED) &&
+				SmartDashboard::GetBoolean("Record Teleop", false))
+		{
+			printf("recording teleop\n");
+			pRecorder->Start();
+		}
+	}
+}
+
+// send robotMessage and keep a copy if we are recording the driver
+
+void RhsRobot::SendAndRecord(ComponentBase *pComponent, RecordTarget eTarget) {
+	pComponent->SendMessage(&robotMessage);
+
+	if(pRecorder)
+	{
+		pRecorder->Record(eTarget, robotMessage);
+	}
 }
 
 // this method is where the magic happens.  It is called every time we get a new message from th driver station
@@ -155,8 +187,8 @@ void RhsRobot::Run() {
 		if (pDrivetrain && pGearFloor)
 		{
 			robotMessage.command = COMMAND_MACRO_HANGGEAR;
- 			pDrivetrain->SendMessage(&robotMessage);
- 			pGearFloor->SendMessage(&robotMessage);
+ 			SendAndRecord(pDrivetrain, RECORD_DRIVETRAIN);
+ 			SendAndRecord(pGearFloor, RECORD_GEARFLOOR);
 		}
 	}
 
@@ -166,16 +198,16 @@ void RhsRobot::Run() {
 		 			robotMessage.params.cheezyDrive.wheel = CHEEZY_DRIVE_WHEEL;
 		 			robotMessage.params.cheezyDrive.throttle = CHEEZY_DRIVE_THROTTLE;
 		 			robotMessage.params.cheezyDrive.bQuickturn = CHEEZY_DRIVE_QUICKTURN;
-		 			pDrivetrain->SendMessage(&robotMessage);
+		 			SendAndRecord(pDrivetrain, RECORD_DRIVETRAIN);
 		 if(PIXIE_LIGHT)
 		 {
 			 robotMessage.command = COMMAND_DRIVETRAIN_PLED_ON;
-			 pDrivetrain->SendMessage(&robotMessage);
+			 SendAndRecord(pDrivetrain, RECORD_DRIVETRAIN);
 		 }
 		 else
 		 {
 			 robotMessage.command = COMMAND_DRIVETRAIN_PLED_OFF;
-			 pDrivetrain->SendMessage(&robotMessage);
+			 SendAndRecord(pDrivetrain, RECORD_DRIVETRAIN);
 		 }
 	}
 
@@ -212,18 +244,18 @@ void RhsRobot::Run() {
 		{
 			robotMessage.command = COMMAND_CLIMBER_UP;
 			robotMessage.params.climber.ClimbUp = 1.0;
-			pClimber->SendMessage(&robotMessage);
+			SendAndRecord(pClimber, RECORD_CLIMBER);
 		}
 		else if (CLIMBER_DOWN)
 		{
 			robotMessage.command = COMMAND_CLIMBER_DOWN;
 			robotMessage.params.climber.ClimbDown = -.2;
-			pClimber->SendMessage(&robotMessage);
+			SendAndRecord(pClimber, RECORD_CLIMBER);
 		}
 		else
 		{
 			robotMessage.command = COMMAND_CLIMBER_STOP;
-			pClimber->SendMessage(&robotMessage);
+			SendAndRecord(pClimber, RECORD_CLIMBER);
 		}
 	}
 
@@ -258,7 +290,8 @@ void RhsRobot::Run() {
             {
                // robotMessage.command = COMMAND_GEARFLOORINTAKE_PREVPOS;
             	robotMessage.command = COMMAND_GEARFLOORINTAKE_DRIVEPOS;
-                pGearFloor->SendMessage(&robotMessage);
+            	robotMessage.params.floor.fTimeout = 0.0;
+                SendAndRecord(pGearFloor, RECORD_GEARFLOOR);
                 bGearButtonDown = true;
             }
         }
@@ -267,8 +300,9 @@ void RhsRobot::Run() {
         	if(!bGearButtonDown)
         	            {
         	            	robotMessage.command = COMMAND_GEARFLOORINTAKE_INTAKEPOS;
+        	            	robotMessage.params.floor.fTimeout = 0.0;
         	                //robotMessage.command = COMMAND_GEARFLOORINTAKE_NEXTPOS;
-        	                pGearFloor->SendMessage(&robotMessage);
+        	                SendAndRecord(pGearFloor, RECORD_GEARFLOOR);
         	                bGearButtonDown = true;
         	            }
         }
@@ -277,7 +311,8 @@ void RhsRobot::Run() {
             if(!bGearButtonDown)
             {
             	robotMessage.command = COMMAND_GEARFLOORINTAKE_RELEASEPOS;
-                pGearFloor->SendMessage(&robotMessage);
+            	robotMessage.params.floor.fTimeout = 0.0;
+                SendAndRecord(pGearFloor, RECORD_GEARFLOOR);
                 bGearButtonDown = true;
             }
         }
@@ -290,35 +325,21 @@ void RhsRobot::Run() {
         {
             robotMessage.command = COMMAND_GEARFLOORINTAKE_PULLIN;
             robotMessage.params.floor.fSpeed = GEAR_FLOOR_PULLIN;
-            pGearFloor->SendMessage(&robotMessage);
+            SendAndRecord(pGearFloor, RECORD_GEARFLOOR);
         }
         else if (GEAR_FLOOR_PUSHOUT > 0.2)
         {
             robotMessage.command = COMMAND_GEARFLOORINTAKE_PUSHOUT;
             robotMessage.params.floor.fSpeed = GEAR_FLOOR_PUSHOUT;
-            pGearFloor->SendMessage(&robotMessage);
+            SendAndRecord(pGearFloor, RECORD_GEARFLOOR);
         }
         else
         {
             robotMessage.command = COMMAND_GEARFLOORINTAKE_STOP;
             robotMessage.params.floor.fSpeed = 0.0;
-            pGearFloor->SendMessage(&robotMessage);
+            SendAndRecord(pGearFloor, RECORD_GEARFLOOR);
         }
     }
-
-	if((iLoop++ % 50) == 0)
-	{
-		robotMessage.command = COMMAND_SYSTEM_CONSTANTS;
-		robotMessage.params.system.fBattery = DriverStation::GetInstance().GetBatteryVoltage();
-
-		// send system health data to interested subsystems
-
-		if(pDrivetrain)
-		{
-			pDrivetrain->SendMessage(&robotMessage);
-		}
-	}
-
 }
 
 START_ROBOT_CLASS(RhsRobot)
@@ -13,6 +13,7 @@
 #include "Climber.h"
 #include "GearIntake.h"
 #include "GearFloorIntake.h"
+#include "DriveRecorder.h"
 
 #include <RhsRobotBase.h>
 #include "WPILib.h"
@@ -32,6 +33,7 @@ private:
 	Hopper* pHopper;
 	GearIntake* pGearIntake;
 	GearFloorIntake* pGearFloor;
+	DriveRecorder* pRecorder;
 
 	cs::UsbCamera camera;
 
@@ -40,10 +42,10 @@ private:
 	void Init();
 	void OnStateChange();
 	void Run();
+	void SendAndRecord(ComponentBase *pComponent, RecordTarget eTarget);
 
 	bool bHopperRunning;
 	bool bGearButtonDown;
-	int iLoop;
 };
 
 #endif //RHS_ROBOT_H
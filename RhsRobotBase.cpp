@@ -106,6 +106,10 @@ void RhsRobotBase::StartCompetition()			//Robot's main function
 
 		if(HasStateChanged())			//Checks for state changes
 		{
+			// components use this to see how long they took to react
+
+			robotMessage.params.state.fTimestamp = Timer::GetFPGATimestamp();
+
 			switch(GetCurrentRobotState())
 			{
 			case ROBOT_STATE_DISABLED:
@@ -19,6 +19,7 @@
  auto [label="Autonomous"],
  check [label="Check\nList"],
  drive [label="Drive\nTrain"],
+ floor [label="Gear\nFloor"],
  test [label="Component\nExample"];
  robot=>* [label="SYSTEM_MSGTIMEOUT"];
  robot=>* [label="SYSTEM_OK"];
@@ -35,6 +36,9 @@
  robot=>drive [label="DRIVE_ARCADE"];
  auto=>drive [label="DRIVE_STRAIGHT"];
  auto=>drive [label="TURN"];
+ auto=>drive [label="AUTO_ARC"];
+ auto=>drive [label="AUTO_PATH"];
+ auto=>floor [label="GEARFLOORINTAKE_*POS"];
  drive=>auto [label="AUTONOMOUS_RESPONSE_OK"]
  drive=>auto [label="AUTONOMOUS_RESPONSE_ERROR"]
 
@@ -70,6 +74,8 @@ enum MessageCommand {
 	COMMAND_DRIVETRAIN_AUTO_PMOVE,    	//!< Tells Drivetrain to move into proximity of barrier
 	COMMAND_DRIVETRAIN_AUTO_TMOVE,    	//!< Tells Drivetrain to move for an amount of time
 	COMMAND_DRIVETRAIN_TURN,
+	COMMAND_DRIVETRAIN_AUTO_ARC,		//!< Tells Drivetrain to drive a curve
+	COMMAND_DRIVETRAIN_AUTO_PATH,		//!< Tells Drivetrain where it should be on a path this control period
 	COMMAND_DRIVETRAIN_PLED_ON,
 	COMMAND_DRIVETRAIN_PLED_OFF,
 
@@ -113,12 +119,16 @@ struct MeasuredMoveParams {
 	float fSpeed;
 	float fDistance;
 	float fTime;
+	float fExitSpeed;	///<keep going this fast when we get there if bBlend
+	bool bBlend;		///<another move follows right away, do not stop
 };
 
 struct ProximityMoveParams {
 	float fSpeed;
 	float fDistance;
 	float fTime;
+	float fExitSpeed;
+	bool bBlend;
 };
 
 struct TimedMoveParams {
@@ -129,6 +139,27 @@ struct TimedMoveParams {
 struct TurnParams {
 	float fAngle;
 	float fTimeout;
+	bool bBlend;		///<another move follows right away, do not stop
+};
+
+struct ArcParams {
+	float fSpeed;
+	float fRadius;		///<feet, to the middle of the robot
+	float fAngle;		///<degrees the heading changes, same sign as a TURN
+	float fTime;
+	float fExitSpeed;
+	bool bBlend;
+};
+
+///One sample of a PathFile, sent every control period while a PATH runs
+struct PathParams {
+	float fX;			///<feet from the start of the path
+	float fY;
+	float fHeading;		///<radians, counter clockwise
+	float fVelocity;	///<feet/second
+	float fCurvature;	///<1/feet, positive turns left
+	bool bFirst;		///<the robot is at the start of the path now
+	bool bLast;			///<respond when this sample is done
 };
 
 ///Used to deliver joystick readings to Drivetrain
@@ -161,12 +192,36 @@ struct GearIntakeParams {
 
 struct GearFloorParams {
 	float fSpeed;
+	float fTimeout;		///<seconds the arm may take to get to a position, 0 for no response
 };
 
 struct SystemParams {
 	float fBattery;
 };
 
+///Why a component says an autonomous command is finished
+enum AutoCompletion {
+	AUTO_COMPLETE_NONE,			//!< still running, or nothing to report
+	AUTO_COMPLETE_DONE,			//!< got to the distance or angle it was asked for
+	AUTO_COMPLETE_TIMEOUT,		//!< ran out of time before getting there
+	AUTO_COMPLETE_DISABLED,		//!< the robot was disabled or left autonomous
+	AUTO_COMPLETE_NO_RESPONSE,	//!< autonomous stopped waiting for the component
+	AUTO_COMPLETE_ERROR,		//!< the component reported an error
+	AUTO_COMPLETE_SLIP,			//!< gave up because the wheels were not moving the robot
+	AUTO_COMPLETE_IMPACT		//!< an approach ran into something before it got there
+};
+
+///Sent back with COMMAND_AUTONOMOUS_RESPONSE_*
+struct ResponseParams {
+	AutoCompletion eReason;
+	double fReceived;	///<CLOCK_MONOTONIC seconds when the component read the command
+};
+
+///Sent with every COMMAND_ROBOT_STATE_* message
+struct StateParams {
+	double fTimestamp;	///<FPGA time the main robot task saw the change
+};
+
 
 ///Used to deliver autonomous values to Drivetrain
 struct AutonomousParams {
@@ -193,17 +248,22 @@ union MessageParams {
 	ProximityMoveParams pmove;
 	TimedMoveParams tmove;
 	TurnParams turn;
+	ArcParams arc;
+	PathParams path;
 	ClimberParams climber;
 	HopperParams hopper;
 	GearIntakeParams gear;
 	GearFloorParams floor;
 	SystemParams system;
+	StateParams state;
+	ResponseParams response;
 };
 
 ///A structure containing a command, a set of parameters, and a reply id, sent between components
 struct RobotMessage {
 	MessageCommand command;
 	const char* replyQ;
+	unsigned uReplyId;		///<echoed in the response so the sender can tell which command finished
 	MessageParams params;
 };
 
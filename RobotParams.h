@@ -29,6 +29,8 @@ const int DEFAULT_PRIORITY      = 50;
 const int COMPONENT_PRIORITY 	= DEFAULT_PRIORITY;
 const int DRIVETRAIN_PRIORITY 	= DEFAULT_PRIORITY;
 const int CHEESY_PRIORITY 	    = DEFAULT_PRIORITY;
+const int ODOMETRY_PRIORITY 	= DEFAULT_PRIORITY;
+const int POWERMONITOR_PRIORITY	= DEFAULT_PRIORITY;
 const int PIXI_PRIORITY 	    = DEFAULT_PRIORITY;
 const int AUTONOMOUS_PRIORITY 	= DEFAULT_PRIORITY;
 const int AUTOEXEC_PRIORITY 	= DEFAULT_PRIORITY;
@@ -37,12 +39,15 @@ const int CLIMBER_PRIORITY		= DEFAULT_PRIORITY;
 const int HOPPER_PRIORITY		= DEFAULT_PRIORITY;
 const int GEARINTAKE_PRIORITY	= DEFAULT_PRIORITY;
 const int GEARFLOORINTAKE_PRIORITY	= DEFAULT_PRIORITY;
+const int GEARARM_PRIORITY		= DEFAULT_PRIORITY;
 
 //Task Names - Used when you view the task list but used by the operating system
 //EXAMPLE: const char* DRIVETRAIN_TASKNAME = "tDrive";
 const char* const COMPONENT_TASKNAME	= "tComponent";
 const char* const DRIVETRAIN_TASKNAME	= "tDrive";
 const char* const CHEESY_TASKNAME	    = "tCheesy";
+const char* const ODOMETRY_TASKNAME	    = "tOdometry";
+const char* const POWERMONITOR_TASKNAME	= "tPower";
 const char* const PIXI_TASKNAME	    	= "tPixi";
 const char* const AUTONOMOUS_TASKNAME	= "tAuto";
 const char* const AUTOEXEC_TASKNAME		= "tAutoEx";
@@ -51,6 +56,7 @@ const char* const CLIMBER_TASKNAME		= "tClimber";
 const char* const HOPPER_TASKNAME		= "tHopper";
 const char* const GEARINTAKE_TASKNAME	= "tGearIntake";
 const char* const GEARFLOORINTAKE_TASKNAME	= "tGearFloor";
+const char* const GEARARM_TASKNAME		= "tGearArm";
 
 //TODO change these variables throughout the code to PIPE or whatever instead  of QUEUE
 //Queue Names - Used when you want to open the message queue for any task
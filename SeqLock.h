@@ -0,0 +1,62 @@
+/** \file
+ * Single writer, many reader publishing without locks.
+ *
+ * The writer bumps the sequence to odd, copies the value in and bumps it to
+ * even again.  A reader copies the value out between two reads of the
+ * sequence and tries again if the writer was in the middle of it, so the
+ * writer never waits and a reader only waits for a copy, not for whatever
+ * the writer holds a lock for.  Read returns how many writes there have
+ * been, a reader that keeps it can tell whether it has seen this value
+ * before.
+ *
+ * T has to be something that can be copied with memcpy.  Only one thread may
+ * call Write.
+ */
+
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <atomic>
+#include <type_traits>
+
+template <typename T> class SeqLock
+{
+public:
+	static_assert(std::is_trivially_copyable<T>::value, "SeqLock can only publish plain data");
+
+	SeqLock() : uSequence(0), value() {}
+
+	void Write(const T &rValue)
+	{
+		unsigned uStart = uSequence.load(std::memory_order_relaxed);
+
+		uSequence.store(uStart + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		value = rValue;
+		uSequence.store(uStart + 2, std::memory_order_release);
+	}
+
+	unsigned Read(T &rValue) const
+	{
+		unsigned uBefore;
+		unsigned uAfter;
+
+		do
+		{
+			uBefore = uSequence.load(std::memory_order_acquire);
+			rValue = value;
+			std::atomic_thread_fence(std::memory_order_acquire);
+			uAfter = uSequence.load(std::memory_order_relaxed);
+		} while((uBefore & 1) || (uBefore != uAfter));
+
+		return(uBefore / 2);
+	}
+
+	unsigned GetWrites() const { return(uSequence.load(std::memory_order_acquire) / 2); };
+
+private:
+	std::atomic<unsigned> uSequence;
+	T value;
+};
+
+#endif  // SEQLOCK_H
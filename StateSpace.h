@@ -0,0 +1,447 @@
+/** \file
+ * Fixed size matrices and state space control.
+ *
+ * Everything is sized by template arguments so a controller is a handful of
+ * float arrays on the stack or in the object that owns it, nothing is ever
+ * allocated and the compiler can unroll the loops.  The design functions are
+ * constexpr, a plant with constants known at build time is discretized and
+ * gets its LQR and Kalman gains worked out by the compiler, and the same
+ * functions run on the robot for plants we only know at startup.
+ *
+ *  - Discretize turns dx/dt = Ax + Bu into x[k+1] = Ax[k] + Bu[k] for a
+ *    control period, holding u over the period like the Talons do.
+ *  - LqrGain picks K for u = K(r - x) that best trades how far x is from r
+ *    against how much u it takes, weighted by Q and R.
+ *  - KalmanGain picks the steady state correction for a KalmanFilter from
+ *    how much the model and the sensors are trusted.
+ *  - PlantInversion works out the u that takes the plant from one reference
+ *    to the next, so the feedback only has to fix what the model gets wrong.
+ *
+ * Q and R are usually diagonal with 1/(largest error we accept)^2, Bryson's
+ * rule, see Diagonal.
+ *
+ * Nothing in here depends on WPILib so the tools can use it too.
+ */
+
+#ifndef STATESPACE_H
+#define STATESPACE_H
+
+const int STATESPACE_RICCATI_ITERATIONS = 2000;		// most plants settle in a few hundred
+const float STATESPACE_RICCATI_TOLERANCE = 1.0e-7;	// relative change we call settled
+const int STATESPACE_TAYLOR_TERMS = 12;				// of exp(A dt) once it is scaled down
+
+template <int R, int C> struct Matrix
+{
+	float m[R][C];
+
+	constexpr Matrix() : m{} {}
+
+	constexpr float &operator()(int r, int c) { return(m[r][c]); }
+	constexpr const float &operator()(int r, int c) const { return(m[r][c]); }
+
+	static constexpr Matrix Identity()
+	{
+		Matrix result;
+
+		for(int i = 0; i < R && i < C; i++)
+		{
+			result.m[i][i] = 1.0;
+		}
+
+		return(result);
+	}
+};
+
+template <int R, int C> constexpr Matrix<R, C> operator+(const Matrix<R, C> &a, const Matrix<R, C> &b)
+{
+	Matrix<R, C> result;
+
+	for(int i = 0; i < R; i++)
+	{
+		for(int j = 0; j < C; j++)
+		{
+			result.m[i][j] = a.m[i][j] + b.m[i][j];
+		}
+	}
+
+	return(result);
+}
+
+template <int R, int C> constexpr Matrix<R, C> operator-(const Matrix<R, C> &a, const Matrix<R, C> &b)
+{
+	Matrix<R, C> result;
+
+	for(int i = 0; i < R; i++)
+	{
+		for(int j = 0; j < C; j++)
+		{
+			result.m[i][j] = a.m[i][j] - b.m[i][j];
+		}
+	}
+
+	return(result);
+}
+
+template <int R, int N, int C> constexpr Matrix<R, C> operator*(const Matrix<R, N> &a, const Matrix<N, C> &b)
+{
+	Matrix<R, C> result;
+
+	for(int i = 0; i < R; i++)
+	{
+		for(int j = 0; j < C; j++)
+		{
+			float fSum = 0.0;
+
+			for(int k = 0; k < N; k++)
+			{
+				fSum += a.m[i][k] * b.m[k][j];
+			}
+
+			result.m[i][j] = fSum;
+		}
+	}
+
+	return(result);
+}
+
+template <int R, int C> constexpr Matrix<R, C> operator*(float f, const Matrix<R, C> &a)
+{
+	Matrix<R, C> result;
+
+	for(int i = 0; i < R; i++)
+	{
+		for(int j = 0; j < C; j++)
+		{
+			result.m[i][j] = f * a.m[i][j];
+		}
+	}
+
+	return(result);
+}
+
+template <int R, int C> constexpr Matrix<C, R> Transpose(const Matrix<R, C> &a)
+{
+	Matrix<C, R> result;
+
+	for(int i = 0; i < R; i++)
+	{
+		for(int j = 0; j < C; j++)
+		{
+			result.m[j][i] = a.m[i][j];
+		}
+	}
+
+	return(result);
+}
+
+constexpr float StateSpaceAbs(float f)
+{
+	return((f < 0.0f) ? -f : f);
+}
+
+template <int R, int C> constexpr float MaxAbs(const Matrix<R, C> &a)
+{
+	float fMax = 0.0;
+
+	for(int i = 0; i < R; i++)
+	{
+		for(int j = 0; j < C; j++)
+		{
+			fMax = (StateSpaceAbs(a.m[i][j]) > fMax) ? StateSpaceAbs(a.m[i][j]) : fMax;
+		}
+	}
+
+	return(fMax);
+}
+
+///Square matrix with these on the diagonal, Diagonal<2>(1.0 / (0.1 * 0.1), 1.0 / (2.0 * 2.0))
+template <int N, typename... Rest> constexpr Matrix<N, N> Diagonal(Rest... values)
+{
+	Matrix<N, N> result;
+	float fValues[N] = { (float)values... };
+
+	for(int i = 0; i < N; i++)
+	{
+		result.m[i][i] = fValues[i];
+	}
+
+	return(result);
+}
+
+///Gauss-Jordan with the biggest pivot, a singular matrix gives all zeros
+template <int N> constexpr Matrix<N, N> Inverse(const Matrix<N, N> &a)
+{
+	Matrix<N, N> work = a;
+	Matrix<N, N> result = Matrix<N, N>::Identity();
+
+	for(int j = 0; j < N; j++)
+	{
+		int iPivot = j;
+
+		for(int i = j + 1; i < N; i++)
+		{
+			if(StateSpaceAbs(work.m[i][j]) > StateSpaceAbs(work.m[iPivot][j]))
+			{
+				iPivot = i;
+			}
+		}
+
+		if(StateSpaceAbs(work.m[iPivot][j]) < 1.0e-12f)
+		{
+			return(Matrix<N, N>());
+		}
+
+		for(int k = 0; k < N; k++)
+		{
+			float fSwap = work.m[j][k];
+			work.m[j][k] = work.m[iPivot][k];
+			work.m[iPivot][k] = fSwap;
+
+			fSwap = result.m[j][k];
+			result.m[j][k] = result.m[iPivot][k];
+			result.m[iPivot][k] = fSwap;
+		}
+
+		float fPivot = work.m[j][j];
+
+		for(int k = 0; k < N; k++)
+		{
+			work.m[j][k] /= fPivot;
+			result.m[j][k] /= fPivot;
+		}
+
+		for(int i = 0; i < N; i++)
+		{
+			float fFactor = work.m[i][j];
+
+			if(i == j)
+			{
+				continue;
+			}
+
+			for(int k = 0; k < N; k++)
+			{
+				work.m[i][k] -= fFactor * work.m[j][k];
+				result.m[i][k] -= fFactor * result.m[j][k];
+			}
+		}
+	}
+
+	return(result);
+}
+
+///exp(a) by scaling it down until the Taylor series is good and squaring back up
+template <int N> constexpr Matrix<N, N> Exponential(const Matrix<N, N> &a)
+{
+	Matrix<N, N> scaled = a;
+	Matrix<N, N> term = Matrix<N, N>::Identity();
+	Matrix<N, N> result = Matrix<N, N>::Identity();
+	int iSquarings = 0;
+
+	while(MaxAbs(scaled) * N > 0.5f)
+	{
+		scaled = 0.5f * scaled;
+		iSquarings++;
+	}
+
+	for(int k = 1; k <= STATESPACE_TAYLOR_TERMS; k++)
+	{
+		term = (1.0f / k) * (term * scaled);
+		result = result + term;
+	}
+
+	for(int i = 0; i < iSquarings; i++)
+	{
+		result = result * result;
+	}
+
+	return(result);
+}
+
+///x[k+1] = Ax[k] + Bu[k], y[k] = Cx[k]
+template <int N, int M, int P> struct DiscretePlant
+{
+	Matrix<N, N> A;
+	Matrix<N, M> B;
+	Matrix<P, N> C;
+};
+
+///Zero order hold, exp([A B; 0 0] dt) = [Ad Bd; 0 I]
+template <int N, int M, int P> constexpr DiscretePlant<N, M, P> Discretize(const Matrix<N, N> &A,
+		const Matrix<N, M> &B, const Matrix<P, N> &C, float fPeriod)
+{
+	Matrix<N + M, N + M> block;
+	DiscretePlant<N, M, P> plant;
+
+	for(int i = 0; i < N; i++)
+	{
+		for(int j = 0; j < N; j++)
+		{
+			block.m[i][j] = A.m[i][j] * fPeriod;
+		}
+
+		for(int j = 0; j < M; j++)
+		{
+			block.m[i][N + j] = B.m[i][j] * fPeriod;
+		}
+	}
+
+	block = Exponential(block);
+
+	for(int i = 0; i < N; i++)
+	{
+		for(int j = 0; j < N; j++)
+		{
+			plant.A.m[i][j] = block.m[i][j];
+		}
+
+		for(int j = 0; j < M; j++)
+		{
+			plant.B.m[i][j] = block.m[i][N + j];
+		}
+	}
+
+	plant.C = C;
+	return(plant);
+}
+
+///Discrete algebraic Riccati equation by iterating it until it stops changing
+template <int N, int M> constexpr Matrix<N, N> SolveRiccati(const Matrix<N, N> &A, const Matrix<N, M> &B,
+		const Matrix<N, N> &Q, const Matrix<M, M> &R)
+{
+	Matrix<N, N> P = Q;
+	Matrix<N, N> next;
+	Matrix<N, N> At = Transpose(A);
+	Matrix<M, N> Bt = Transpose(B);
+
+	for(int i = 0; i < STATESPACE_RICCATI_ITERATIONS; i++)
+	{
+		Matrix<N, M> AtPB = At * P * B;
+
+		next = Q + At * P * A - AtPB * Inverse(R + Bt * P * B) * Transpose(AtPB);
+
+		if(MaxAbs(next - P) <= STATESPACE_RICCATI_TOLERANCE * (MaxAbs(P) + 1.0f))
+		{
+			return(next);
+		}
+
+		P = next;
+	}
+
+	return(P);
+}
+
+///K for u = K(r - x)
+template <int N, int M> constexpr Matrix<M, N> LqrGain(const Matrix<N, N> &A, const Matrix<N, M> &B,
+		const Matrix<N, N> &Q, const Matrix<M, M> &R)
+{
+	Matrix<N, N> P = SolveRiccati(A, B, Q, R);
+	Matrix<M, N> Bt = Transpose(B);
+
+	return(Inverse(R + Bt * P * B) * Bt * P * A);
+}
+
+///L for x += L(y - Cx) after each predict, Q is the model noise and R the sensor noise
+template <int N, int P> constexpr Matrix<N, P> KalmanGain(const Matrix<N, N> &A, const Matrix<P, N> &C,
+		const Matrix<N, N> &Q, const Matrix<P, P> &R)
+{
+	// the estimator is the dual of the regulator
+
+	Matrix<N, N> Sigma = SolveRiccati(Transpose(A), Transpose(C), Q, R);
+	Matrix<N, P> Ct = Transpose(C);
+
+	return(Sigma * Ct * Inverse(C * Sigma * Ct + R));
+}
+
+///Estimates the state from what went in and what the sensors say
+template <int N, int M, int P> class KalmanFilter
+{
+public:
+	constexpr KalmanFilter() : plant(), L(), x() {}
+
+	constexpr KalmanFilter(const DiscretePlant<N, M, P> &rPlant, const Matrix<N, P> &rGain)
+		: plant(rPlant), L(rGain), x() {}
+
+	void Reset(const Matrix<N, 1> &rState) { x = rState; };
+	void Predict(const Matrix<M, 1> &u) { x = plant.A * x + plant.B * u; };
+	void Correct(const Matrix<P, 1> &y) { x = x + L * (y - plant.C * x); };
+	const Matrix<N, 1> &GetState() const { return(x); };
+
+private:
+	DiscretePlant<N, M, P> plant;
+	Matrix<N, P> L;
+	Matrix<N, 1> x;
+};
+
+///u that moves the plant from the reference now to the next one
+template <int N, int M> class PlantInversion
+{
+public:
+	constexpr PlantInversion() : A(), Binverse(), r() {}
+
+	constexpr PlantInversion(const Matrix<N, N> &rA, const Matrix<N, M> &rB)
+		: A(rA), Binverse(Inverse(Transpose(rB) * rB) * Transpose(rB)), r() {}
+
+	void Reset(const Matrix<N, 1> &rReference) { r = rReference; };
+
+	Matrix<M, 1> Calculate(const Matrix<N, 1> &rNext)
+	{
+		Matrix<M, 1> u = Binverse * (rNext - A * r);
+
+		r = rNext;
+		return(u);
+	}
+
+private:
+	Matrix<N, N> A;
+	Matrix<M, N> Binverse;		//!< least squares, B is rarely square
+	Matrix<N, 1> r;
+};
+
+///Feedforward, LQR feedback on the Kalman estimate and a limit on what goes out
+template <int N, int M, int P> class StateSpaceLoop
+{
+public:
+	constexpr StateSpaceLoop() : K(), observer(), feedforward(), u(), fLimit(0.0) {}
+
+	constexpr StateSpaceLoop(const DiscretePlant<N, M, P> &rPlant, const Matrix<M, N> &rK,
+			const Matrix<N, P> &rL, float fOutputLimit)
+		: K(rK), observer(rPlant, rL), feedforward(rPlant.A, rPlant.B), u(), fLimit(fOutputLimit) {}
+
+	void Reset(const Matrix<N, 1> &rState)
+	{
+		observer.Reset(rState);
+		feedforward.Reset(rState);
+		u = Matrix<M, 1>();
+	}
+
+	///One control period, y is what the sensors read now, r where we want to be next period
+	const Matrix<M, 1> &Update(const Matrix<P, 1> &y, const Matrix<N, 1> &r)
+	{
+		// the estimate moves on with what we put out last period before the
+		// sensors correct it
+
+		observer.Predict(u);
+		observer.Correct(y);
+
+		u = K * (r - observer.GetState()) + feedforward.Calculate(r);
+
+		for(int i = 0; i < M; i++)
+		{
+			u.m[i][0] = (u.m[i][0] > fLimit) ? fLimit : ((u.m[i][0] < -fLimit) ? -fLimit : u.m[i][0]);
+		}
+
+		return(u);
+	}
+
+	const Matrix<N, 1> &GetState() const { return(observer.GetState()); };
+
+private:
+	Matrix<M, N> K;
+	KalmanFilter<N, M, P> observer;
+	PlantInversion<N, M> feedforward;
+	Matrix<M, 1> u;
+	float fLimit;
+};
+
+#endif  // STATESPACE_H
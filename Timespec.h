@@ -0,0 +1,38 @@
+/** \file
+ * Arithmetic on the struct timespec we hand to clock_nanosleep.
+ *
+ * Threads that run on a fixed period keep an absolute wake up time and add
+ * the period to it each time round, so a slow iteration does not push every
+ * one after it.  These keep tv_nsec in 0..999999999 while doing that.
+ */
+
+#ifndef TIMESPEC_H
+#define TIMESPEC_H
+
+#include <time.h>
+#include <math.h>
+
+//! seconds from rEarlier to rLater, negative if rLater is before rEarlier
+inline double TimespecDiff(const struct timespec &rLater, const struct timespec &rEarlier)
+{
+	return((rLater.tv_sec - rEarlier.tv_sec) + (rLater.tv_nsec - rEarlier.tv_nsec) / 1.0e9);
+}
+
+//! move rTime by fSeconds, which may be negative
+inline void TimespecAdd(struct timespec &rTime, double fSeconds)
+{
+	long long llNanoseconds = rTime.tv_nsec + llround(fSeconds * 1.0e9);
+
+	// works for negative times too, tv_nsec always ends up in 0..999999999
+
+	rTime.tv_sec += llNanoseconds / 1000000000LL;
+	rTime.tv_nsec = llNanoseconds % 1000000000LL;
+
+	if(rTime.tv_nsec < 0)
+	{
+		rTime.tv_sec--;
+		rTime.tv_nsec += 1000000000L;
+	}
+}
+
+#endif  // TIMESPEC_H
@@ -0,0 +1,140 @@
+/** \file
+ * Notices when the wheels are not doing what the robot is doing.
+ *
+ * The wheel acceleration is a difference of the encoder speeds, and the Talons
+ * only send those every 20 ms, so it is stepped and noisy.  Both accelerations
+ * go through the same low pass so a real disagreement is not just one of them
+ * lagging the other.
+ *
+ * The impact check uses the accelerometer as it comes, a wall stops us in a
+ * couple of periods and the filter would round that off.
+ */
+
+#include <TractionMonitor.h>
+#include <math.h>
+
+TractionMonitor::TractionMonitor(float fTrackWidth)
+{
+	this->fTrackWidth = fTrackWidth;
+	bStarted = false;
+	fLastTime = 0.0;
+	fLastSpeed = 0.0;
+	fLastRawAccel = 0.0;
+	fWheelAccel = 0.0;
+	fMeasuredAccel = 0.0;
+	fBias = 0.0;
+	fGripSpeed = 0.0;
+	Reset();
+}
+
+void TractionMonitor::Reset(void)
+{
+	// the next update starts the speeds and filters over, the bias we keep
+
+	bStarted = false;
+	fYawError = 0.0;
+	fAccelError = 0.0;
+	fSpeedError = 0.0;
+	fDisagreeTime = 0.0;
+	fSlipTime = 0.0;
+	bSlipping = false;
+	fJoltTime = -1.0;
+	fJoltDirection = 0.0;
+	bImpact = false;
+}
+
+void TractionMonitor::Update(double fTime, float fLeftSpeed, float fRightSpeed, float fGyroRate, float fAccel)
+{
+	float fSpeed = (fLeftSpeed + fRightSpeed) / 2.0;
+	float fRawAccel = fAccel * TRACTION_GRAVITY;
+	float fPeriod = fTime - fLastTime;
+	float fFilter;
+	float fJerk;
+	bool bDisagree;
+
+	fLastTime = fTime;
+
+	if(!bStarted || (fPeriod <= 0.0) || (fPeriod > TRACTION_MAX_GAP))
+	{
+		fLastSpeed = fSpeed;
+		fGripSpeed = fSpeed;
+		fWheelAccel = 0.0;
+		fMeasuredAccel = fRawAccel - fBias;
+		fLastRawAccel = fRawAccel;
+		bStarted = true;
+		return;
+	}
+
+	fJerk = (fRawAccel - fLastRawAccel) / fPeriod;
+	fLastRawAccel = fRawAccel;
+
+	// a jolt against the way we are going, fLastSpeed is still from before it
+
+	if((fJoltTime < 0.0) && (fabs(fLastSpeed) >= TRACTION_IMPACT_SPEED))
+	{
+		fJoltDirection = (fLastSpeed > 0.0) ? 1.0 : -1.0;
+
+		if((-fJoltDirection * (fRawAccel - fBias) >= TRACTION_IMPACT_DECEL) &&
+				(-fJoltDirection * fJerk >= TRACTION_IMPACT_JERK))
+		{
+			fJoltTime = 0.0;
+		}
+	}
+
+	fFilter = fPeriod / (TRACTION_FILTER + fPeriod);
+	fWheelAccel += fFilter * ((fSpeed - fLastSpeed) / fPeriod - fWheelAccel);
+	fMeasuredAccel += fFilter * (fRawAccel - fBias - fMeasuredAccel);
+	fLastSpeed = fSpeed;
+
+	// add up what the accelerometer says, leaning on the wheels just enough
+	// that the drift dies away
+
+	fGripSpeed += (fRawAccel - fBias) * fPeriod + TRACTION_SPEED_LEAK * fPeriod * (fSpeed - fGripSpeed);
+
+	// turning clockwise makes the left side go further than the right
+
+	fYawError = (fLeftSpeed - fRightSpeed) / fTrackWidth * 180.0 / M_PI - fGyroRate;
+	fAccelError = fWheelAccel - fMeasuredAccel;
+	fSpeedError = fSpeed - fGripSpeed;
+
+	bDisagree = (fabs(fYawError) > TRACTION_YAW_ERROR) || (fabs(fAccelError) > TRACTION_ACCEL_ERROR) ||
+			(fabs(fSpeedError) > TRACTION_SPEED_ERROR);
+
+	if(bDisagree)
+	{
+		fDisagreeTime += fPeriod;
+	}
+	else
+	{
+		// only learn the bias while everything agrees, otherwise a spin
+		// would teach us the accelerometer is wrong
+
+		fDisagreeTime = 0.0;
+		fBias += TRACTION_BIAS_LEAK * fPeriod * (fRawAccel - fBias - fWheelAccel);
+	}
+
+	bSlipping = (fDisagreeTime >= TRACTION_CONFIRM);
+
+	if(bSlipping)
+	{
+		fSlipTime += fPeriod;
+	}
+
+	// the wheels have to back the jolt up, a bump or a kick from another
+	// robot passes without them slowing
+
+	if(fJoltTime >= 0.0)
+	{
+		if((-fJoltDirection * fWheelAccel >= TRACTION_IMPACT_WHEEL) || bSlipping)
+		{
+			bImpact = true;
+		}
+
+		fJoltTime += fPeriod;
+
+		if(fJoltTime > TRACTION_IMPACT_WINDOW)
+		{
+			fJoltTime = -1.0;
+		}
+	}
+}
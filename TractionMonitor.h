@@ -0,0 +1,83 @@
+/** \file
+ * Notices when the wheels are not doing what the robot is doing.
+ *
+ * The encoders only know how far the wheels turned.  If they spin on the
+ * carpet or the robot is pushing on the airship they still count, and a move
+ * that stops on distance stops in the wrong place.  Every control period we
+ * check the encoders three ways against sensors that do not care about the
+ * wheels:
+ *
+ *  - the turn rate the two sides make against the gyro's
+ *  - the acceleration of the wheels against the roboRIO's accelerometer
+ *  - the wheel speed against the accelerometer added up over time, which is
+ *    pulled slowly back to the wheels so its drift never builds up
+ *
+ * Any of them out by more than its limit for long enough and we call it
+ * slipping.  The accelerometer's bias is learned while the wheels grip.
+ *
+ * An impact is a hard jolt against the way we are going, a big deceleration
+ * arriving faster than the drive could ever brake, that the wheels then agree
+ * with by slowing down or spinning.
+ *
+ * Speeds are feet/second forward positive, turn rates degrees/second clockwise
+ * like the gyro.  Nothing in here depends on WPILib.
+ */
+
+#ifndef TRACTIONMONITOR_H
+#define TRACTIONMONITOR_H
+
+const float TRACTION_GRAVITY = 32.174;		// feet/s/s in a g
+const float TRACTION_FILTER = 0.04;			// seconds, smooths both accelerations the same so they line up
+const float TRACTION_YAW_ERROR = 30.0;		// degrees/s the sides may disagree with the gyro by
+const float TRACTION_ACCEL_ERROR = 8.0;		// feet/s/s the wheels may disagree with the accelerometer by
+const float TRACTION_SPEED_ERROR = 1.5;		// feet/s the wheels may disagree with the added up accelerometer by
+const float TRACTION_SPEED_LEAK = 1.0;		// 1/s, how fast the added up speed is pulled back to the wheels
+const float TRACTION_BIAS_LEAK = 1.0;		// 1/s, how fast the accelerometer bias is learned
+const float TRACTION_CONFIRM = 0.04;		// seconds a disagreement has to last before we believe it
+const float TRACTION_MAX_GAP = 0.1;			// seconds, longer between updates and we start over
+const float TRACTION_IMPACT_DECEL = 24.0;	// feet/s/s against the way we are going, three quarters of a g
+const float TRACTION_IMPACT_JERK = 1000.0;	// feet/s/s/s, the drive on its own never gets near this
+const float TRACTION_IMPACT_SPEED = 0.5;	// feet/s, slower than this and there is nothing to hit with
+const float TRACTION_IMPACT_WHEEL = 8.0;	// feet/s/s the wheels must slow by to agree
+const float TRACTION_IMPACT_WINDOW = 0.08;	// seconds after the jolt the wheels have to agree in
+
+class TractionMonitor
+{
+public:
+	TractionMonitor(float fTrackWidth);
+
+	void Reset(void);
+	void Update(double fTime, float fLeftSpeed, float fRightSpeed, float fGyroRate, float fAccel);
+
+	bool IsSlipping() const { return(bSlipping); };
+	float GetSlipTime() const { return(fSlipTime); };		//!< seconds slipping since Reset
+	float GetGripSpeed() const { return(fGripSpeed); };		//!< feet/s, our best guess at what the robot is doing
+	float GetYawError() const { return(fYawError); };
+	float GetAccelError() const { return(fAccelError); };
+	float GetSpeedError() const { return(fSpeedError); };
+	bool HadImpact() const { return(bImpact); };			//!< since Reset
+
+private:
+	float fTrackWidth;
+	bool bStarted;
+	double fLastTime;
+	float fLastSpeed;
+	float fLastRawAccel;
+	float fJoltTime;			//!< seconds since a jolt the wheels have not agreed with yet, < 0 for none
+	float fJoltDirection;		//!< the way we were going when it came
+
+	float fWheelAccel;			//!< feet/s/s, filtered
+	float fMeasuredAccel;		//!< feet/s/s, filtered with the bias taken out
+	float fBias;				//!< feet/s/s the accelerometer reads standing still
+	float fGripSpeed;
+
+	float fYawError;
+	float fAccelError;
+	float fSpeedError;
+	float fDisagreeTime;
+	float fSlipTime;
+	bool bSlipping;
+	bool bImpact;
+};
+
+#endif  // TRACTIONMONITOR_H
@@ -0,0 +1,83 @@
+/** \file
+ * Hands the latest value from one thread to another without locks.
+ *
+ * There are three copies.  The writer always has one to fill, the reader
+ * always has one to read and the third is the latest finished value waiting
+ * to be picked up.  Publishing and picking up just swap an index, so neither
+ * side ever waits for the other and the reader always gets the newest value
+ * written, never a half written one.  Values the reader did not get to in
+ * time are dropped.
+ *
+ * Every value carries the sequence number Write gave it, and Read says whether
+ * what it returns is newer than what the reader had before.
+ *
+ * Only one thread may call Write and only one thread may call Read.
+ */
+
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <stddef.h>
+
+#include <atomic>
+
+template <typename T> class TripleBuffer
+{
+public:
+	TripleBuffer() : uMiddle(1), iBack(0), iFront(2), uWrites(0)
+	{
+		for(int i = 0; i < 3; i++)
+		{
+			slots[i].uSequence = 0;
+			slots[i].value = T();
+		}
+	}
+
+	void Write(const T &rValue)
+	{
+		slots[iBack].value = rValue;
+		slots[iBack].uSequence = ++uWrites;
+
+		// swap our finished copy for the waiting one and mark it new
+
+		iBack = uMiddle.exchange(iBack | FRESH, std::memory_order_acq_rel) & INDEX;
+	}
+
+	bool Read(T &rValue, unsigned *pSequence = NULL)
+	{
+		bool bFresh = (uMiddle.load(std::memory_order_relaxed) & FRESH) != 0;
+
+		// only swap if there is something new, otherwise read our copy again
+
+		if(bFresh)
+		{
+			iFront = uMiddle.exchange(iFront, std::memory_order_acq_rel) & INDEX;
+		}
+
+		rValue = slots[iFront].value;
+
+		if(pSequence)
+		{
+			*pSequence = slots[iFront].uSequence;
+		}
+
+		return(bFresh);
+	}
+
+private:
+	static const unsigned INDEX = 0x3;
+	static const unsigned FRESH = 0x4;
+
+	struct Slot {
+		T value;
+		unsigned uSequence;		//!< 0 until the first Write
+	};
+
+	Slot slots[3];
+	std::atomic<unsigned> uMiddle;		//!< index of the waiting copy, FRESH if the reader has not had it
+	unsigned iBack;						//!< only the writer touches this
+	unsigned iFront;					//!< only the reader touches this
+	unsigned uWrites;
+};
+
+#endif  // TRIPLEBUFFER_H
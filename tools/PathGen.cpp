@@ -0,0 +1,544 @@
+/** \file
+ * Makes PATH trajectories on a laptop.
+ *
+ * The waypoints file has one waypoint a line, x and y in feet and the heading
+ * in degrees counter clockwise, anything after a # is ignored:
+ *
+ *     0 0 0
+ *     6 3 45
+ *     9 8 90
+ *
+ * Each pair of waypoints is joined by a quintic Hermite spline leaving and
+ * arriving at the waypoint headings with no curvature at the ends, so the
+ * pieces join smoothly.  The speed along the path is limited so the outside
+ * wheel stays under full speed and the sideways acceleration stays under the
+ * limit, then speeding up and slowing down are limited going forward and
+ * backward along it.  That is the fastest the robot can follow that spline.
+ * The result is sampled and written as a PathFile the robot maps at startup.
+ *
+ * With -g the limits come from the drivetrain characterization file instead
+ * of a guess: full speed is what the motors reach on the voltage we allow
+ * and the acceleration falls off with speed the way the motors' does, on
+ * top of the -a limit for the carpet.
+ *
+ * How hard the splines pull out of each waypoint changes their shape and so
+ * how fast they can be driven, every routine is planned with a few of them
+ * on all the cores and the fastest is kept.  Each routine is written next to
+ * its waypoints with a .bin extension and its time reported, anything that
+ * will not fit in autonomous is marked.
+ *
+ * Build from the tools directory with:
+ *
+ *     g++ -std=c++14 -pthread -I.. -o PathGen PathGen.cpp ../PathFile.cpp ../DriveCharacterize.cpp
+ *
+ * Usage:
+ *
+ *     PathGen [-v speed] [-a accel] [-c accel] [-w width] [-g gains] [-V volts]
+ *             [-p period] [-t seconds] [-j threads] [-o path.bin] waypoints.txt ...
+ */
+
+#include <DriveCharacterize.h>
+#include <PathFile.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+const int SPLINE_STEPS = 1000;			// points along each spline for the speed limits
+const float CONTROL_PERIOD = 0.005;		// MOTIONPROFILE_PERIOD, the drivetrain's auto loop
+const float MAX_PERIOD = 0.05;			// the drivetrain stops if samples are further apart than fBlendTimeout
+const float AUTONOMOUS_TIME = 15.0;		// seconds, a path longer than this can not be a routine
+const float TANGENT_SCALES[] = { 0.8, 1.0, 1.2, 1.4, 1.7 };	// how far the ends pull, times the straight distance
+const int TANGENT_SCALE_COUNT = sizeof(TANGENT_SCALES) / sizeof(TANGENT_SCALES[0]);
+
+struct Waypoint {
+	double fX;
+	double fY;
+	double fHeading;		// radians
+};
+
+struct PathPoint {
+	double fX;
+	double fY;
+	double fHeading;
+	double fCurvature;
+	double fDistance;		// feet along the path to here
+	double fVelocity;
+};
+
+struct PathLimits {
+	double fMaxSpeed;		// feet/second, full speed
+	double fAccel;			// feet/s/s along the path
+	double fCentripetal;	// feet/s/s sideways
+	double fTrackWidth;		// feet
+	bool bModel;			// the motor model below is good
+	double fVolts;			// what we let the motors have, the battery sags
+	double fKs;				// the weaker side of the drive, volts
+	double fKv;				// volts per foot/second
+	double fKa;				// volts per foot/second/second
+};
+
+///One routine, planned with each tangent scale
+struct PathJob {
+	string sWaypoints;
+	string sPath;
+	vector<Waypoint> waypoints;
+	double fDuration[TANGENT_SCALE_COUNT];		// seconds, < 0 if it could not be planned
+	double fDistance[TANGENT_SCALE_COUNT];
+	vector<PathSample> samples[TANGENT_SCALE_COUNT];
+	int iBest;
+};
+
+static bool ReadWaypoints(const char *szFile, vector<Waypoint> &rWaypoints)
+{
+	ifstream waypointStream(szFile);
+	string sLine;
+	Waypoint waypoint;
+
+	if(!waypointStream.is_open())
+	{
+		return(false);
+	}
+
+	while(getline(waypointStream, sLine))
+	{
+		istringstream lineStream(sLine.substr(0, sLine.find('#')));
+
+		if(lineStream >> waypoint.fX >> waypoint.fY >> waypoint.fHeading)
+		{
+			waypoint.fHeading *= M_PI / 180.0;
+			rWaypoints.push_back(waypoint);
+		}
+	}
+
+	return(true);
+}
+
+static void AddSpline(const Waypoint &rStart, const Waypoint &rEnd, double fTangentScale, vector<PathPoint> &rPoints)
+{
+	double fScale = fTangentScale * hypot(rEnd.fX - rStart.fX, rEnd.fY - rStart.fY);
+	double fStartDX = fScale * cos(rStart.fHeading);
+	double fStartDY = fScale * sin(rStart.fHeading);
+	double fEndDX = fScale * cos(rEnd.fHeading);
+	double fEndDY = fScale * sin(rEnd.fHeading);
+	PathPoint point;
+
+	// quintic Hermite basis with zero second derivative at both ends, the
+	// first point of each piece is the last point of the one before
+
+	for(int i = (rPoints.empty() ? 0 : 1); i <= SPLINE_STEPS; i++)
+	{
+		double t = (double)i / SPLINE_STEPS;
+		double t2 = t * t;
+		double t3 = t2 * t;
+		double t4 = t3 * t;
+		double t5 = t4 * t;
+
+		double h0 = 1.0 - 10.0 * t3 + 15.0 * t4 - 6.0 * t5;
+		double h1 = t - 6.0 * t3 + 8.0 * t4 - 3.0 * t5;
+		double h5 = 10.0 * t3 - 15.0 * t4 + 6.0 * t5;
+		double h4 = -4.0 * t3 + 7.0 * t4 - 3.0 * t5;
+
+		double d0 = -30.0 * t2 + 60.0 * t3 - 30.0 * t4;
+		double d1 = 1.0 - 18.0 * t2 + 32.0 * t3 - 15.0 * t4;
+		double d5 = -d0;
+		double d4 = -12.0 * t2 + 28.0 * t3 - 15.0 * t4;
+
+		double dd0 = -60.0 * t + 180.0 * t2 - 120.0 * t3;
+		double dd1 = -36.0 * t + 96.0 * t2 - 60.0 * t3;
+		double dd5 = -dd0;
+		double dd4 = -24.0 * t + 84.0 * t2 - 60.0 * t3;
+
+		double dx = d0 * rStart.fX + d1 * fStartDX + d4 * fEndDX + d5 * rEnd.fX;
+		double dy = d0 * rStart.fY + d1 * fStartDY + d4 * fEndDY + d5 * rEnd.fY;
+		double ddx = dd0 * rStart.fX + dd1 * fStartDX + dd4 * fEndDX + dd5 * rEnd.fX;
+		double ddy = dd0 * rStart.fY + dd1 * fStartDY + dd4 * fEndDY + dd5 * rEnd.fY;
+
+		point.fX = h0 * rStart.fX + h1 * fStartDX + h4 * fEndDX + h5 * rEnd.fX;
+		point.fY = h0 * rStart.fY + h1 * fStartDY + h4 * fEndDY + h5 * rEnd.fY;
+		point.fHeading = atan2(dy, dx);
+		point.fCurvature = (dx * ddy - dy * ddx) / pow(dx * dx + dy * dy, 1.5);
+		point.fDistance = rPoints.empty() ? 0.0 : rPoints.back().fDistance +
+				hypot(point.fX - rPoints.back().fX, point.fY - rPoints.back().fY);
+		point.fVelocity = 0.0;
+
+		// keep the heading continuous so the robot never sees a jump of a full turn
+
+		if(!rPoints.empty())
+		{
+			point.fHeading = rPoints.back().fHeading + remainder(point.fHeading - rPoints.back().fHeading, 2.0 * M_PI);
+		}
+
+		rPoints.push_back(point);
+	}
+}
+
+static double SpeedUpLimit(const PathLimits &rLimits, double fVelocity, double fCurvature)
+{
+	double fOutside = 1.0 + fabs(fCurvature) * rLimits.fTrackWidth / 2.0;
+
+	// the outside wheel has to do the most, it gets what is left of the
+	// voltage after friction and holding its speed
+
+	if(!rLimits.bModel)
+	{
+		return(rLimits.fAccel);
+	}
+
+	return(max(min(rLimits.fAccel,
+			(rLimits.fVolts - rLimits.fKs - rLimits.fKv * fVelocity * fOutside) / (rLimits.fKa * fOutside)), 0.0));
+}
+
+static double SlowDownLimit(const PathLimits &rLimits, double fVelocity, double fCurvature)
+{
+	double fOutside = 1.0 + fabs(fCurvature) * rLimits.fTrackWidth / 2.0;
+
+	// full reverse voltage, friction and the motors' own back EMF all help
+	// to stop, it is the carpet that limits it
+
+	if(!rLimits.bModel)
+	{
+		return(rLimits.fAccel);
+	}
+
+	return(min(rLimits.fAccel,
+			(rLimits.fVolts + rLimits.fKs + rLimits.fKv * fVelocity * fOutside) / (rLimits.fKa * fOutside)));
+}
+
+static void LimitSpeed(const PathLimits &rLimits, vector<PathPoint> &rPoints)
+{
+	double fStep;
+	double fAccel;
+
+	// the outside wheel goes faster than the middle of the robot on a curve,
+	// and the robot slides if it goes round too fast
+
+	for(unsigned int i = 0; i < rPoints.size(); i++)
+	{
+		double fCurvature = fabs(rPoints[i].fCurvature);
+
+		rPoints[i].fVelocity = rLimits.fMaxSpeed / (1.0 + fCurvature * rLimits.fTrackWidth / 2.0);
+
+		if(fCurvature > 1.0e-6)
+		{
+			rPoints[i].fVelocity = min(rPoints[i].fVelocity, sqrt(rLimits.fCentripetal / fCurvature));
+		}
+	}
+
+	// start and finish stopped, speed up and slow down no faster than the limit
+
+	rPoints.front().fVelocity = 0.0;
+	rPoints.back().fVelocity = 0.0;
+
+	for(unsigned int i = 1; i < rPoints.size(); i++)
+	{
+		fStep = rPoints[i].fDistance - rPoints[i - 1].fDistance;
+		fAccel = SpeedUpLimit(rLimits, rPoints[i - 1].fVelocity, rPoints[i - 1].fCurvature);
+		rPoints[i].fVelocity = min(rPoints[i].fVelocity,
+				sqrt(rPoints[i - 1].fVelocity * rPoints[i - 1].fVelocity + 2.0 * fAccel * fStep));
+	}
+
+	for(int i = (int)rPoints.size() - 2; i >= 0; i--)
+	{
+		fStep = rPoints[i + 1].fDistance - rPoints[i].fDistance;
+		fAccel = SlowDownLimit(rLimits, rPoints[i + 1].fVelocity, rPoints[i + 1].fCurvature);
+		rPoints[i].fVelocity = min(rPoints[i].fVelocity,
+				sqrt(rPoints[i + 1].fVelocity * rPoints[i + 1].fVelocity + 2.0 * fAccel * fStep));
+	}
+}
+
+static void SampleInTime(const vector<PathPoint> &rPoints, double fPeriod, vector<PathSample> &rSamples)
+{
+	double fTime = 0.0;
+	double fNextSample = 0.0;
+	double fStep;
+	double fStepTime;
+	double fFraction;
+	PathSample sample;
+
+	// walk along the points keeping time, dropping a sample every control period
+
+	for(unsigned int i = 1; i < rPoints.size(); i++)
+	{
+		const PathPoint &rFrom = rPoints[i - 1];
+		const PathPoint &rTo = rPoints[i];
+
+		fStep = rTo.fDistance - rFrom.fDistance;
+		fStepTime = (fStep > 0.0) ? 2.0 * fStep / max(rFrom.fVelocity + rTo.fVelocity, 1.0e-6) : 0.0;
+
+		while(fNextSample <= fTime + fStepTime)
+		{
+			fFraction = (fStepTime > 0.0) ? (fNextSample - fTime) / fStepTime : 0.0;
+
+			sample.fX = rFrom.fX + (rTo.fX - rFrom.fX) * fFraction;
+			sample.fY = rFrom.fY + (rTo.fY - rFrom.fY) * fFraction;
+			sample.fHeading = rFrom.fHeading + (rTo.fHeading - rFrom.fHeading) * fFraction;
+			sample.fVelocity = rFrom.fVelocity + (rTo.fVelocity - rFrom.fVelocity) * fFraction;
+			sample.fCurvature = rFrom.fCurvature + (rTo.fCurvature - rFrom.fCurvature) * fFraction;
+			rSamples.push_back(sample);
+
+			fNextSample += fPeriod;
+		}
+
+		fTime += fStepTime;
+	}
+
+	// always finish exactly on the last waypoint, stopped
+
+	sample.fX = rPoints.back().fX;
+	sample.fY = rPoints.back().fY;
+	sample.fHeading = rPoints.back().fHeading;
+	sample.fVelocity = 0.0;
+	sample.fCurvature = rPoints.back().fCurvature;
+	rSamples.push_back(sample);
+}
+
+static void PlanJob(const PathLimits &rLimits, double fPeriod, PathJob &rJob, int iScale)
+{
+	vector<PathPoint> points;
+
+	for(unsigned int i = 1; i < rJob.waypoints.size(); i++)
+	{
+		AddSpline(rJob.waypoints[i - 1], rJob.waypoints[i], TANGENT_SCALES[iScale], points);
+	}
+
+	LimitSpeed(rLimits, points);
+	SampleInTime(points, fPeriod, rJob.samples[iScale]);
+
+	// a stall anywhere along it means it can not be driven at all
+
+	rJob.fDistance[iScale] = points.back().fDistance;
+	rJob.fDuration[iScale] = (rJob.samples[iScale].size() - 1) * fPeriod;
+
+	if((rJob.samples[iScale].size() > (size_t)PATHFILE_MAX_SAMPLES) || !isfinite(rJob.fDuration[iScale]))
+	{
+		rJob.fDuration[iScale] = -1.0;
+		rJob.samples[iScale].clear();
+	}
+}
+
+static bool UseGains(const char *szFile, PathLimits &rLimits)
+{
+	DriveGains gains;
+	const DriveModel *pWeaker;
+
+	if(!DriveCharacterize::Load(szFile, gains))
+	{
+		return(false);
+	}
+
+	// plan for the side that takes more to drive, the other one can keep up
+
+	pWeaker = (gains.leftModel.fKv + gains.leftModel.fKa > gains.rightModel.fKv + gains.rightModel.fKa) ?
+			&gains.leftModel : &gains.rightModel;
+
+	if(!(pWeaker->fKv > 0.0) || !(pWeaker->fKa > 0.0) || !(pWeaker->fKs < rLimits.fVolts))
+	{
+		return(false);
+	}
+
+	rLimits.bModel = true;
+	rLimits.fKs = max(gains.leftModel.fKs, gains.rightModel.fKs);
+	rLimits.fKv = pWeaker->fKv;
+	rLimits.fKa = pWeaker->fKa;
+	rLimits.fMaxSpeed = min(rLimits.fMaxSpeed, (rLimits.fVolts - rLimits.fKs) / rLimits.fKv);
+	return(true);
+}
+
+static string PathName(const string &sWaypoints)
+{
+	size_t uDot = sWaypoints.find_last_of('.');
+	size_t uSlash = sWaypoints.find_last_of('/');
+
+	if((uDot == string::npos) || ((uSlash != string::npos) && (uDot < uSlash)))
+	{
+		return(sWaypoints + ".bin");
+	}
+
+	return(sWaypoints.substr(0, uDot) + ".bin");
+}
+
+static void Usage(const char *szProgram)
+{
+	fprintf(stderr, "usage: %s [-v speed] [-a accel] [-c accel] [-w width] [-g gains] [-V volts]\n"
+			"       [-p period] [-t seconds] [-j threads] [-o path] waypoints ...\n", szProgram);
+}
+
+int main(int argc, char *argv[])
+{
+	PathLimits limits = { 5.24, 6.0, 6.0, 2.0, false, 10.0, 0.0, 0.0, 0.0 };
+	const char *szGains = NULL;
+	const char *szOutput = NULL;
+	double fPeriod = CONTROL_PERIOD;
+	double fLongest = AUTONOMOUS_TIME;
+	int iThreads = std::thread::hardware_concurrency();
+	vector<PathJob> jobs;
+	vector<std::thread> workers;
+	std::atomic<int> iNextTask(0);
+	int iOption;
+	int iReturn = 0;
+
+	while((iOption = getopt(argc, argv, "v:a:c:w:g:V:p:t:j:o:")) != -1)
+	{
+		switch(iOption)
+		{
+		case 'v':
+			limits.fMaxSpeed = atof(optarg);
+			break;
+
+		case 'a':
+			limits.fAccel = atof(optarg);
+			break;
+
+		case 'c':
+			limits.fCentripetal = atof(optarg);
+			break;
+
+		case 'w':
+			limits.fTrackWidth = atof(optarg);
+			break;
+
+		case 'g':
+			szGains = optarg;
+			break;
+
+		case 'V':
+			limits.fVolts = atof(optarg);
+			break;
+
+		case 'p':
+			fPeriod = atof(optarg);
+			break;
+
+		case 't':
+			fLongest = atof(optarg);
+			break;
+
+		case 'j':
+			iThreads = atoi(optarg);
+			break;
+
+		case 'o':
+			szOutput = optarg;
+			break;
+
+		default:
+			Usage(argv[0]);
+			return(1);
+		}
+	}
+
+	if((optind >= argc) || (szOutput && (optind + 1 != argc)))
+	{
+		Usage(argv[0]);
+		return(1);
+	}
+
+	if(!(fPeriod >= CONTROL_PERIOD) || (fPeriod > MAX_PERIOD))
+	{
+		fprintf(stderr, "the period has to be from %0.3f to %0.3f s\n", CONTROL_PERIOD, MAX_PERIOD);
+		return(1);
+	}
+
+	if(szGains)
+	{
+		if(!UseGains(szGains, limits))
+		{
+			fprintf(stderr, "can not use the gains in %s\n", szGains);
+			return(1);
+		}
+
+		printf("%s: kS %0.3f kV %0.3f kA %0.3f, %0.2f ft/s on %0.1f V\n", szGains,
+				limits.fKs, limits.fKv, limits.fKa, limits.fMaxSpeed, limits.fVolts);
+	}
+
+	for(int i = optind; i < argc; i++)
+	{
+		PathJob job;
+
+		job.sWaypoints = argv[i];
+		job.sPath = szOutput ? szOutput : PathName(argv[i]);
+		job.iBest = -1;
+
+		if(!ReadWaypoints(argv[i], job.waypoints))
+		{
+			fprintf(stderr, "can not open %s\n", argv[i]);
+			return(1);
+		}
+
+		if(job.waypoints.size() < 2)
+		{
+			fprintf(stderr, "%s: a path needs at least two waypoints\n", argv[i]);
+			return(1);
+		}
+
+		jobs.push_back(job);
+	}
+
+	// every routine with every tangent scale is its own task, the workers
+	// take the next one until there are none left
+
+	iThreads = max(1, min(iThreads, (int)jobs.size() * TANGENT_SCALE_COUNT));
+
+	for(int i = 0; i < iThreads; i++)
+	{
+		workers.push_back(std::thread([&]()
+		{
+			int iTask;
+
+			while((iTask = iNextTask++) < (int)jobs.size() * TANGENT_SCALE_COUNT)
+			{
+				PlanJob(limits, fPeriod, jobs[iTask / TANGENT_SCALE_COUNT], iTask % TANGENT_SCALE_COUNT);
+			}
+		}));
+	}
+
+	for(unsigned int i = 0; i < workers.size(); i++)
+	{
+		workers[i].join();
+	}
+
+	for(unsigned int i = 0; i < jobs.size(); i++)
+	{
+		PathJob &rJob = jobs[i];
+
+		for(int j = 0; j < TANGENT_SCALE_COUNT; j++)
+		{
+			if((rJob.fDuration[j] >= 0.0) && ((rJob.iBest < 0) || (rJob.fDuration[j] < rJob.fDuration[rJob.iBest])))
+			{
+				rJob.iBest = j;
+			}
+		}
+
+		if(rJob.iBest < 0)
+		{
+			printf("%-24s can not be driven in %0.0f s\n", rJob.sWaypoints.c_str(), PATHFILE_MAX_SAMPLES * fPeriod);
+			iReturn = 1;
+			continue;
+		}
+
+		if(!PathFile::Write(rJob.sPath.c_str(), rJob.samples[rJob.iBest].data(),
+				rJob.samples[rJob.iBest].size(), fPeriod))
+		{
+			fprintf(stderr, "can not write %s\n", rJob.sPath.c_str());
+			return(1);
+		}
+
+		printf("%-24s %6.2f s %6.2f ft, tangents %0.1f, %d samples -> %s%s\n", rJob.sWaypoints.c_str(),
+				rJob.fDuration[rJob.iBest], rJob.fDistance[rJob.iBest], TANGENT_SCALES[rJob.iBest],
+				(int)rJob.samples[rJob.iBest].size(), rJob.sPath.c_str(),
+				(rJob.fDuration[rJob.iBest] > fLongest) ? "  TOO LONG" : "");
+	}
+
+	return(iReturn);
+}
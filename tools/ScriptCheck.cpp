@@ -0,0 +1,443 @@
+/** \file
+ * Checks an autonomous script on a laptop before it goes to the robot.
+ *
+ * The script is compiled with the same AutoProgram code the robot uses, so
+ * anything the robot would reject is reported here with its line number.
+ * Each routine is then run through a simple drivetrain model to estimate how
+ * long it takes, both the expected time and the worst case where every
+ * command runs into its timeout.  REPLAY and PATH look for their files next to
+ * the script, the same place the robot keeps them.
+ *
+ * Build from the tools directory with:
+ *
+ *     g++ -std=c++14 -I.. -o ScriptCheck ScriptCheck.cpp ../AutoProgram.cpp ../DriveRecorder.cpp ../MotionProfile.cpp ../PathFile.cpp
+ *
+ * Usage:
+ *
+ *     ScriptCheck [-s rpm] [-a accel] [-j jerk] [-w width] [-r range] RhsScript.txt
+ *
+ * Exit status is 1 if the script does not compile and 2 if a routine is not
+ * expected to finish within the autonomous period.
+ */
+
+#include <AutoProgram.h>
+#include <AutoParser.h>
+#include <DriveRecorder.h>
+#include <MotionProfile.h>
+#include <PathFile.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// the model, defaults come from Drivetrain.h and the autonomous code
+
+const float AUTONOMOUS_PERIOD = 15.0;		// seconds
+const float FEET_PER_REV = (3.14159 * 2.0 * 2.0 / 12.0);	// REVSPERFOOT in Drivetrain.h
+const float RESPONSE_OVERHEAD = 0.02;		// message to drivetrain and back
+const float PROXIMITY_LED_WAIT = 0.5;		// StartStraightDrive waits for the LED
+const float GEAR_HANG_TIME = 1.0;			// Autonomous::GearHangMacro
+const float TURN_RATE = 200.0;				// fTurnRate, degrees/s
+const float TURN_ACCEL = 600.0;				// fTurnAccel
+const float TURN_JERK = 4000.0;				// fTurnJerk
+const float TURN_SETTLE = 0.1;				// fTurnSettle
+const float BRANCH_GRACE = 0.25;			// AUTONOMOUS_BRANCH_GRACE
+
+static string sScriptDirectory = ".";	// where REPLAY recordings are
+
+struct DriveModel {
+	float fFullSpeedRPM;		// FULLSPEED_FROMTALONS
+	float fAccel;				// feet/s/s, how fast the Talons get up to speed
+	float fJerk;				// feet/s/s/s, fProfileJerk
+	float fTrackWidth;			// feet between the left and right wheels
+	float fProximityRange;		// feet, what the ultrasonic is assumed to read at a PMOVE
+};
+
+struct Estimate {
+	float fExpected;
+	float fWorst;
+};
+
+static float FullSpeedFeet(const DriveModel &rModel)
+{
+	return(rModel.fFullSpeedRPM / 60.0 * FEET_PER_REV);
+}
+
+static float StraightTime(const DriveModel &rModel, float fSpeed, float fDistance, float fEntrySpeed)
+{
+	float fVelocity = fabs(fSpeed) * FullSpeedFeet(rModel);
+	float fEntry = min(fabs(fEntrySpeed) * FullSpeedFeet(rModel), fVelocity);
+
+	if(fVelocity <= 0.0)
+	{
+		return(INFINITY);
+	}
+
+	// ARC is not profiled, it speeds up from wherever the last move left us,
+	// cruises, then stops hard or hands over to the next move
+
+	return(fabs(fDistance) / fVelocity + (fVelocity - fEntry) * (fVelocity - fEntry) /
+			(2.0 * rModel.fAccel * fVelocity));
+}
+
+static float ProfileTime(const DriveModel &rModel, float fSpeed, float fDistance, float fEntrySpeed,
+		float fExitSpeed)
+{
+	static MotionProfile profile;
+
+	// MMOVE and PMOVE follow the same profile the drivetrain plans
+
+	if(!profile.Plan(fabs(fDistance), fabs(fEntrySpeed) * FullSpeedFeet(rModel), fabs(fSpeed) * FullSpeedFeet(rModel),
+			fabs(fExitSpeed) * FullSpeedFeet(rModel), rModel.fAccel, rModel.fJerk))
+	{
+		return((fSpeed == 0.0) ? INFINITY : 0.0);
+	}
+
+	return(profile.GetDuration());
+}
+
+static float TurnTime(const DriveModel &rModel, float fAngle)
+{
+	static MotionProfile profile;
+
+	// IterateTurn follows a profile at up to TURN_RATE, or slower if the wheels
+	// can not go round that fast, then has to sit still for TURN_SETTLE
+
+	float fMaxRate = 2.0 * FullSpeedFeet(rModel) / rModel.fTrackWidth * 180.0 / M_PI;
+
+	if(!profile.Plan(fabs(fAngle), 0.0, min(TURN_RATE, fMaxRate), 0.0, TURN_ACCEL, TURN_JERK))
+	{
+		return(0.0);
+	}
+
+	return(profile.GetDuration() + TURN_SETTLE);
+}
+
+static Estimate EstimateInstruction(const DriveModel &rModel, const AutoInstruction &rInstruction,
+		float fEntrySpeed, vector<string> &rWarnings)
+{
+	Estimate estimate = { 0.0, 0.0 };
+	float fModel = 0.0;
+	char szWarning[200];
+
+	switch(rInstruction.iCommand)
+	{
+	case AUTO_TOKEN_DELAY:
+		estimate.fExpected = estimate.fWorst = rInstruction.fParam[0];
+		break;
+
+	case AUTO_TOKEN_GEAR_HANG:
+		estimate.fExpected = estimate.fWorst = GEAR_HANG_TIME;
+		break;
+
+	case AUTO_TOKEN_WAIT_UNTIL:
+		// we can not know when a sensor trips, it might already be true
+		estimate.fExpected = 0.0;
+		estimate.fWorst = rInstruction.fTimeout;
+		return(estimate);
+
+	case AUTO_TOKEN_MMOVE:
+		fModel = ProfileTime(rModel, rInstruction.fParam[0], rInstruction.fParam[1], fEntrySpeed,
+				rInstruction.bBlend ? rInstruction.fExitSpeed : 0.0);
+		break;
+
+	case AUTO_TOKEN_MPROXIMITY:
+		fModel = PROXIMITY_LED_WAIT + ProfileTime(rModel, rInstruction.fParam[0],
+				max(0.0f, rModel.fProximityRange - rInstruction.fParam[1]), 0.0,
+				rInstruction.bBlend ? rInstruction.fExitSpeed : 0.0);
+		break;
+
+	case AUTO_TOKEN_TURN:
+		fModel = TurnTime(rModel, rInstruction.fParam[0]);
+		break;
+
+	case AUTO_TOKEN_ARC:
+		// the middle of the robot goes round at the requested speed
+		fModel = StraightTime(rModel, rInstruction.fParam[0],
+				rInstruction.fParam[1] * fabs(rInstruction.fParam[2]) * M_PI / 180.0, fEntrySpeed);
+		break;
+
+	case AUTO_TOKEN_REPLAY:
+	{
+		static DriveRecorder recording;
+		string sPath = sScriptDirectory + "/" + rInstruction.sParam[0];
+
+		if(recording.Load(sPath.c_str()))
+		{
+			estimate.fExpected = estimate.fWorst = recording.GetDuration() / 1.0e6;
+		}
+		else
+		{
+			snprintf(szWarning, sizeof(szWarning), "line %d: can not read recording %s, counted as 0s",
+					rInstruction.iLine, sPath.c_str());
+			rWarnings.push_back(szWarning);
+		}
+
+		return(estimate);
+	}
+
+	case AUTO_TOKEN_PATH:
+	{
+		PathFile path;
+		string sPath = sScriptDirectory + "/" + rInstruction.sParam[0];
+
+		if(path.Open(sPath.c_str()))
+		{
+			fModel = path.GetDuration();
+		}
+		else
+		{
+			snprintf(szWarning, sizeof(szWarning), "line %d: can not read path %s, counted as 0s",
+					rInstruction.iLine, sPath.c_str());
+			rWarnings.push_back(szWarning);
+		}
+		break;
+	}
+
+	default:
+		break;
+	}
+
+	// commands that report back can not run past their own timeout
+
+	if(rInstruction.fTimeout > 0.0)
+	{
+		estimate.fExpected = min(fModel, rInstruction.fTimeout) + RESPONSE_OVERHEAD;
+		estimate.fWorst = rInstruction.fTimeout + RESPONSE_OVERHEAD;
+
+		if(fModel > rInstruction.fTimeout)
+		{
+			snprintf(szWarning, sizeof(szWarning), "line %d: %s needs about %0.2f s but times out after %0.2f s",
+					rInstruction.iLine, autoTokens[rInstruction.iCommand].szName, fModel, rInstruction.fTimeout);
+			rWarnings.push_back(szWarning);
+		}
+	}
+
+	return(estimate);
+}
+
+static bool CheckRoutine(const DriveModel &rModel, const AutoRoutine &rRoutine)
+{
+	Estimate total = { 0.0, 0.0 };
+	vector<Estimate> branches;
+	vector<Estimate> ifStart;		// totals when each open IF started
+	vector<Estimate> ifSide;		// totals at the end of the IF side, once we get to ELSE
+	vector<string> warnings;
+	bool bParallel = false;
+	bool bEnd = false;
+	float fEntrySpeed = 0.0;		// what a BLEND ON move handed over
+
+	printf("\nMODE %d %s\n", rRoutine.iMode, rRoutine.sName.c_str());
+	printf("  line  %-32s %9s %9s\n", "command", "expected", "worst");
+
+	for(unsigned int i = 0; i < rRoutine.instructions.size(); i++)
+	{
+		const AutoInstruction &rInstruction = rRoutine.instructions[i];
+		Estimate estimate = EstimateInstruction(rModel, rInstruction, fEntrySpeed, warnings);
+
+		if((rInstruction.iCommand != AUTO_TOKEN_MESSAGE) && (rInstruction.iCommand != AUTO_TOKEN_DEBUG))
+		{
+			fEntrySpeed = rInstruction.fExitSpeed;
+		}
+
+		if(rInstruction.iCommand == AUTO_TOKEN_END)
+		{
+			bEnd = true;
+		}
+
+		if(rInstruction.iCommand == AUTO_TOKEN_PARALLEL)
+		{
+			bParallel = true;
+			branches.clear();
+			estimate.fExpected = estimate.fWorst = 0.0;
+		}
+		else if(rInstruction.iCommand == AUTO_TOKEN_JOIN)
+		{
+			// ALL waits for the slowest branch, ANY for the quickest one that reports back
+
+			bool bAll = (rInstruction.sParam[0] == "ALL");
+			float fJoin = rInstruction.fParam[1] > 0.0 ? rInstruction.fParam[1] : INFINITY;
+
+			estimate.fExpected = bAll ? 0.0 : INFINITY;
+			estimate.fWorst = bAll ? 0.0 : INFINITY;
+
+			for(unsigned int j = 0; j < branches.size(); j++)
+			{
+				if(bAll)
+				{
+					estimate.fExpected = max(estimate.fExpected, branches[j].fExpected);
+					estimate.fWorst = max(estimate.fWorst, branches[j].fWorst + BRANCH_GRACE);
+				}
+				else if(branches[j].fWorst > 0.0)
+				{
+					estimate.fExpected = min(estimate.fExpected, branches[j].fExpected);
+					estimate.fWorst = min(estimate.fWorst, branches[j].fWorst + BRANCH_GRACE);
+				}
+			}
+
+			if(isinf(estimate.fExpected))
+			{
+				estimate.fExpected = estimate.fWorst = 0.0;
+			}
+
+			estimate.fExpected = min(estimate.fExpected, fJoin);
+			estimate.fWorst = min(estimate.fWorst, fJoin);
+			bParallel = false;
+		}
+		else if(rInstruction.iCommand == AUTO_TOKEN_IF)
+		{
+			ifStart.push_back(total);
+			ifSide.push_back(total);
+		}
+		else if(rInstruction.iCommand == AUTO_TOKEN_ELSE)
+		{
+			// the ELSE side starts from where the IF did
+
+			ifSide.back() = total;
+			total = ifStart.back();
+		}
+		else if(rInstruction.iCommand == AUTO_TOKEN_ENDIF)
+		{
+			// only one side runs, count the longer one
+
+			total.fExpected = max(total.fExpected, ifSide.back().fExpected);
+			total.fWorst = max(total.fWorst, ifSide.back().fWorst);
+			ifStart.pop_back();
+			ifSide.pop_back();
+		}
+		else if(bParallel)
+		{
+			// branches do not take time of their own, the JOIN does
+
+			branches.push_back(estimate);
+			printf("  %4d    %-30s %9s %9s\n", rInstruction.iLine, rInstruction.sText.c_str(), "|", "|");
+			continue;
+		}
+
+		total.fExpected += estimate.fExpected;
+		total.fWorst += estimate.fWorst;
+
+		printf("  %4d  %-32s %9.2f %9.2f\n", rInstruction.iLine, rInstruction.sText.c_str(),
+				estimate.fExpected, estimate.fWorst);
+	}
+
+	printf("        %-32s %9.2f %9.2f\n", "total", total.fExpected, total.fWorst);
+
+	if(!bEnd)
+	{
+		warnings.push_back("no END, the drivetrain is never told autonomous is complete");
+	}
+
+	if(total.fWorst > AUTONOMOUS_PERIOD)
+	{
+		char szWarning[100];
+
+		snprintf(szWarning, sizeof(szWarning), "worst case %0.2f s is longer than autonomous", total.fWorst);
+		warnings.push_back(szWarning);
+	}
+
+	for(unsigned int i = 0; i < warnings.size(); i++)
+	{
+		printf("  WARNING %s\n", warnings[i].c_str());
+	}
+
+	if(total.fExpected > AUTONOMOUS_PERIOD)
+	{
+		printf("  ERROR expected %0.2f s, this routine will not finish in %0.0f s\n",
+				total.fExpected, AUTONOMOUS_PERIOD);
+		return(false);
+	}
+
+	return(true);
+}
+
+int main(int argc, char *argv[])
+{
+	DriveModel model = { 300.0, 8.0, 40.0, 2.0, 4.0 };
+	ifstream scriptStream;
+	stringstream scriptText;
+	AutoProgram program;
+	bool bFits = true;
+	int iOption;
+
+	while((iOption = getopt(argc, argv, "s:a:j:w:r:")) != -1)
+	{
+		switch(iOption)
+		{
+		case 's':
+			model.fFullSpeedRPM = atof(optarg);
+			break;
+
+		case 'a':
+			model.fAccel = atof(optarg);
+			break;
+
+		case 'j':
+			model.fJerk = atof(optarg);
+			break;
+
+		case 'w':
+			model.fTrackWidth = atof(optarg);
+			break;
+
+		case 'r':
+			model.fProximityRange = atof(optarg);
+			break;
+
+		default:
+			fprintf(stderr, "usage: %s [-s rpm] [-a accel] [-j jerk] [-w width] [-r range] script\n", argv[0]);
+			return(1);
+		}
+	}
+
+	if(optind >= argc)
+	{
+		fprintf(stderr, "usage: %s [-s rpm] [-a accel] [-j jerk] [-w width] [-r range] script\n", argv[0]);
+		return(1);
+	}
+
+	scriptStream.open(argv[optind]);
+
+	if(!scriptStream.is_open())
+	{
+		fprintf(stderr, "can not open %s\n", argv[optind]);
+		return(1);
+	}
+
+	scriptText << scriptStream.rdbuf();
+
+	if(strrchr(argv[optind], '/'))
+	{
+		sScriptDirectory.assign(argv[optind], strrchr(argv[optind], '/') - argv[optind]);
+	}
+
+	if(!program.Compile(scriptText.str()))
+	{
+		printf("%s:%d: error: %s\n", argv[optind], program.iErrorLine, program.sError.c_str());
+		return(1);
+	}
+
+	for(unsigned int i = 0; i < program.warnings.size(); i++)
+	{
+		printf("%s: warning: %s\n", argv[optind], program.warnings[i].c_str());
+	}
+
+	printf("%s: %d routines, full speed %0.2f ft/s\n", argv[optind],
+			(int)program.routines.size(), FullSpeedFeet(model));
+
+	for(unsigned int i = 0; i < program.routines.size(); i++)
+	{
+		bFits &= CheckRoutine(model, program.routines[i]);
+	}
+
+	return(bFits ? 0 : 2);
+}
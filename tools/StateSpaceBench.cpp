@@ -0,0 +1,234 @@
+/** \file
+ * Times the state space controllers on a laptop.
+ *
+ * The drive side and the gear arm are designed with the same constants the
+ * robot uses, at compile time, then each piece is run a lot of times to get
+ * its cost per control period.  A short closed loop run against the model
+ * checks the gains actually settle.  The roboRIO is a lot slower than a
+ * laptop, take the ratios between the numbers more than the numbers.
+ *
+ * Build from the tools directory with:
+ *
+ *     g++ -std=c++14 -O2 -I.. -o StateSpaceBench StateSpaceBench.cpp
+ *
+ * Usage:
+ *
+ *     StateSpaceBench [iterations]
+ */
+
+#include <StateSpace.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <algorithm>
+
+constexpr float PERIOD = 0.005;			// the drivetrain's auto loop
+constexpr float ARM_PERIOD = 0.01;		// the gear arm's thread
+
+// a drive side from a typical characterization, volts per ft/s and ft/s/s
+
+constexpr float DRIVE_KV = 2.0;
+constexpr float DRIVE_KA = 0.35;
+
+// the gear arm, volts per rotation/s and rotation/s/s, see GearFloorIntake.h
+
+constexpr float ARM_KV = 1.5;
+constexpr float ARM_KA = 0.05;
+constexpr float ARM_GRAVITY = -1.0;		// volts the model does not know about
+
+static double Now(void)
+{
+	struct timespec tNow;
+
+	clock_gettime(CLOCK_MONOTONIC, &tNow);
+	return(tNow.tv_sec + tNow.tv_nsec * 1.0e-9);
+}
+
+static constexpr DiscretePlant<1, 1, 1> DrivePlant(void)
+{
+	Matrix<1, 1> A;
+	Matrix<1, 1> B;
+	Matrix<1, 1> C;
+
+	A(0, 0) = -DRIVE_KV / DRIVE_KA;
+	B(0, 0) = 1.0 / DRIVE_KA;
+	C(0, 0) = 1.0;
+
+	return(Discretize(A, B, C, PERIOD));
+}
+
+static constexpr DiscretePlant<2, 1, 1> ArmPlant(void)
+{
+	Matrix<2, 2> A;
+	Matrix<2, 1> B;
+	Matrix<1, 2> C;
+
+	A(0, 1) = 1.0;
+	A(1, 1) = -ARM_KV / ARM_KA;
+	B(1, 0) = 1.0 / ARM_KA;
+	C(0, 0) = 1.0;
+
+	return(Discretize(A, B, C, ARM_PERIOD));
+}
+
+static constexpr DiscretePlant<3, 1, 1> ArmObserverPlant(void)
+{
+	Matrix<3, 3> A;
+	Matrix<3, 1> B;
+	Matrix<1, 3> C;
+
+	A(0, 1) = 1.0;
+	A(1, 1) = -ARM_KV / ARM_KA;
+	A(1, 2) = 1.0 / ARM_KA;
+	B(1, 0) = 1.0 / ARM_KA;
+	C(0, 0) = 1.0;
+
+	return(Discretize(A, B, C, ARM_PERIOD));
+}
+
+// all worked out by the compiler, the robot does the same for the arm
+
+constexpr DiscretePlant<1, 1, 1> drivePlant = DrivePlant();
+constexpr Matrix<1, 1> driveK = LqrGain(drivePlant.A, drivePlant.B, Diagonal<1>(1.0 / (0.2 * 0.2)), Diagonal<1>(1.0 / (12.0 * 12.0)));
+constexpr Matrix<1, 1> driveL = KalmanGain(drivePlant.A, drivePlant.C, Diagonal<1>(0.5 * 0.5), Diagonal<1>(0.1 * 0.1));
+constexpr DiscretePlant<2, 1, 1> armPlant = ArmPlant();
+constexpr Matrix<1, 2> armK = LqrGain(armPlant.A, armPlant.B, Diagonal<2>(1.0 / (0.01 * 0.01), 1.0 / (0.5 * 0.5)), Diagonal<1>(1.0 / (6.0 * 6.0)));
+constexpr Matrix<2, 1> armL = KalmanGain(armPlant.A, armPlant.C, Diagonal<2>(0.001 * 0.001, 0.1 * 0.1), Diagonal<1>(0.001 * 0.001));
+constexpr DiscretePlant<3, 1, 1> armObserverPlant = ArmObserverPlant();
+constexpr Matrix<3, 1> armObserverL = KalmanGain(armObserverPlant.A, armObserverPlant.C,
+		Diagonal<3>(0.001 * 0.001, 0.1 * 0.1, 0.5 * 0.5), Diagonal<1>(0.001 * 0.001));
+
+template <typename F> static void Time(const char *szName, int iIterations, F function)
+{
+	double fStart = Now();
+
+	for(int i = 0; i < iIterations; i++)
+	{
+		function(i);
+	}
+
+	printf("%-32s %8.1f ns\n", szName, (Now() - fStart) / iIterations * 1.0e9);
+}
+
+int main(int argc, char *argv[])
+{
+	int iIterations = (argc > 1) ? atoi(argv[1]) : 1000000;
+	volatile float fSink = 0.0;
+	Matrix<1, 1> y1;
+	Matrix<1, 1> r1;
+	Matrix<2, 1> r2;
+
+	printf("drive K %0.3f L %0.3f, arm K %0.2f %0.2f L %0.3f %0.3f\n",
+			driveK(0, 0), driveL(0, 0), armK(0, 0), armK(0, 1), armL(0, 0), armL(1, 0));
+
+	// check the loops settle on the model before timing them
+
+	StateSpaceLoop<1, 1, 1> drive(drivePlant, driveK, driveL, 12.0);
+	StateSpaceLoop<2, 1, 1> arm(armPlant, armK, armL, 6.0);
+	Matrix<1, 1> x1;
+	Matrix<2, 1> x2;
+
+	r1(0, 0) = 4.0;
+	r2(0, 0) = 0.25;
+
+	for(int i = 0; i < 400; i++)
+	{
+		x1 = drivePlant.A * x1 + drivePlant.B * drive.Update(drivePlant.C * x1, r1);
+		x2 = armPlant.A * x2 + armPlant.B * arm.Update(armPlant.C * x2, r2);
+	}
+
+	printf("after 400 periods the drive is at %0.3f ft/s of 4, the arm at %0.4f rotations of 0.25\n",
+			x1(0, 0), x2(0, 0));
+
+	// the arm the way GearFloorIntake runs it, pulled on by a voltage it does
+	// not know about that the third state has to find
+
+	KalmanFilter<3, 1, 1> armObserver(armObserverPlant, armObserverL);
+	PlantInversion<2, 1> armFeedforward(armPlant.A, armPlant.B);
+	Matrix<2, 1> xArm;
+	Matrix<3, 1> x3;
+	Matrix<1, 1> uArm;
+	Matrix<1, 1> gravity;
+
+	gravity(0, 0) = ARM_GRAVITY;
+	x2 = Matrix<2, 1>();
+
+	for(int i = 0; i < 200; i++)
+	{
+		armObserver.Predict(uArm);
+		armObserver.Correct(armPlant.C * x2);
+		x3 = armObserver.GetState();
+		xArm(0, 0) = x3(0, 0);
+		xArm(1, 0) = x3(1, 0);
+		uArm = armK * (r2 - xArm) + armFeedforward.Calculate(r2);
+		uArm(0, 0) = std::min(std::max(uArm(0, 0) - x3(2, 0), -6.0f), 6.0f);
+		x2 = armPlant.A * x2 + armPlant.B * (uArm + gravity);
+	}
+
+	printf("after 200 periods with %0.1f V against it the arm is at %0.4f rotations of 0.25, it thinks %0.2f V\n\n",
+			ARM_GRAVITY, x2(0, 0), x3(2, 0));
+
+	Time("drive loop update (1 state)", iIterations, [&](int i)
+	{
+		y1(0, 0) = (i & 1) ? 4.0 : 3.9;
+		fSink = drive.Update(y1, r1)(0, 0);
+	});
+
+	Time("arm loop update (2 states)", iIterations, [&](int i)
+	{
+		y1(0, 0) = (i & 1) ? 0.25 : 0.24;
+		fSink = arm.Update(y1, r2)(0, 0);
+	});
+
+	KalmanFilter<2, 1, 1> filter(armPlant, armL);
+	Matrix<1, 1> u1;
+
+	Time("kalman predict and correct (2)", iIterations, [&](int i)
+	{
+		u1(0, 0) = (i & 1) ? 1.0 : -1.0;
+		y1(0, 0) = (i & 1) ? 0.25 : 0.24;
+		filter.Predict(u1);
+		filter.Correct(y1);
+		fSink = filter.GetState()(0, 0);
+	});
+
+	Time("kalman predict and correct (3)", iIterations, [&](int i)
+	{
+		u1(0, 0) = (i & 1) ? 1.0 : -1.0;
+		y1(0, 0) = (i & 1) ? 0.25 : 0.24;
+		armObserver.Predict(u1);
+		armObserver.Correct(y1);
+		fSink = armObserver.GetState()(2, 0);
+	});
+
+	// designing is what the drivetrain does once at startup
+
+	Matrix<2, 2> armA;
+	Matrix<2, 1> armB;
+	Matrix<1, 2> armC;
+
+	armA(0, 1) = 1.0;
+	armA(1, 1) = -ARM_KV / ARM_KA;
+	armB(1, 0) = 1.0 / ARM_KA;
+	armC(0, 0) = 1.0;
+
+	Time("discretize (2 states)", iIterations / 100, [&](int i)
+	{
+		fSink = Discretize(armA, armB, armC, PERIOD + (i & 1) * 1.0e-6f).A(1, 1);
+	});
+
+	Time("lqr gain (2 states)", iIterations / 1000, [&](int i)
+	{
+		fSink = LqrGain(armPlant.A, armPlant.B, Diagonal<2>(1.0 / (0.01 * 0.01), 1.0 / (0.5 * 0.5)),
+				Diagonal<1>(1.0 / (6.0 * 6.0 + (i & 1))))(0, 0);
+	});
+
+	Time("kalman gain (2 states)", iIterations / 1000, [&](int i)
+	{
+		fSink = KalmanGain(armPlant.A, armPlant.C, Diagonal<2>(0.001 * 0.001, 0.1 * 0.1),
+				Diagonal<1>(0.001 * 0.001 + (i & 1) * 1.0e-7))(0, 0);
+	});
+
+	return((int)fSink * 0);
+}